@@ -7,7 +7,23 @@
 
 #include "buffer.h"
 
-Buffer::Buffer(int init_size) : buffer(init_size), read_pos(0), write_pos(0) {}
+size_t Buffer::high_water = 0;
+
+Buffer::Buffer(int init_size_) : buffer(nullptr), cap(0), init_size(init_size_), read_pos(0), write_pos(0) {
+    assert(init_size_ > 0);
+}
+
+Buffer::~Buffer() {
+    release();
+}
+
+void Buffer::release() {
+    if(!buffer) { return; }
+    BufferPool::get_instance()->free(buffer, cap);
+    buffer = nullptr;
+    cap = 0;
+    read_pos = write_pos = 0;
+}
 
 /* 返回缓冲区可读的字节数 */
 size_t Buffer::readable_bytes() const {
@@ -15,7 +31,7 @@ size_t Buffer::readable_bytes() const {
 }
 /* 返回缓冲区可写的字节数 */
 size_t Buffer::writeable_bytes() const {
-    return buffer.size() - write_pos;
+    return cap - write_pos;
 }
 /* 返回缓冲区头部可利用的字节数 */
 size_t Buffer::front_bytes() const {
@@ -40,6 +56,9 @@ char* Buffer::write_ptr() {
 void Buffer::retrieve(size_t len) {
     assert(len <= readable_bytes());
     read_pos += len;
+    if(read_pos == write_pos) {
+        on_empty();
+    }
 }
 /* 取出 end 之前的数据 */
 void Buffer::retrieve_until(const char* end) {
@@ -48,10 +67,15 @@ void Buffer::retrieve_until(const char* end) {
 }
 /* 取出缓冲区中的全部数据 */
 void Buffer::retrieve_all() {
-    // 清空缓冲区
-    bzero(&buffer[0], buffer.size());
-    read_pos = 0;
-    write_pos = 0;
+    on_empty();
+}
+
+/* 数据取空：读写位置回到头部，不需要搬移数据；容量超过高水位时归还内存池 */
+void Buffer::on_empty() {
+    read_pos = write_pos = 0;
+    if(cap > high_water) {
+        release();
+    }
 }
 /* 取得缓冲区中的所有数据并返回 */
 std::string Buffer::retrieve_all_to_str() {
@@ -96,6 +120,9 @@ void Buffer::ensure_writeable(size_t len) {
 ssize_t Buffer::read_fd(int fd, int* save_errno) {
     char buff[65535];
     struct iovec iov[2];
+    if(!buffer) {
+        ensure_writeable(init_size);                    // 第一次读取时才借用内存块
+    }
     const size_t writeable = writeable_bytes();
     /* 分散读，保证数据全部读完 */
     iov[0].iov_base = begin_ptr() + write_pos;
@@ -111,7 +138,7 @@ ssize_t Buffer::read_fd(int fd, int* save_errno) {
         write_pos += len;
     }
     else {
-        write_pos = buffer.size();
+        write_pos = cap;
         append(buff, len - writeable);
     }
     return len;
@@ -125,27 +152,38 @@ ssize_t Buffer::write_fd(int fd, int *save_errno) {
         *save_errno = errno;
         return len;
     }
-    read_pos += len;
+    retrieve(len);
     return len;
 }
 /* 返回指向缓冲区开始位置的指针 */
 char* Buffer::begin_ptr() {
-    return &*buffer.begin();
+    return buffer;
 }
 
 const char* Buffer::begin_ptr() const {
-    return &*buffer.begin();
+    return buffer;
 }
 
-/* 根据缓冲区中可用空间大小来调整或扩大缓冲区 */
+/* 根据缓冲区中可用空间大小来调整或扩大缓冲区，扩大时只搬移可读数据并紧凑到头部 */
 void Buffer::adjust_space(size_t len) {
     if(writeable_bytes() + front_bytes() < len) {
-        buffer.resize(write_pos + len + 1);
+        size_t readable = readable_bytes();
+        size_t new_cap = std::max(std::max(cap * 2, readable + len), init_size);
+        char* block = BufferPool::get_instance()->alloc(new_cap);
+        assert(block);
+        if(readable) {
+            memcpy(block, begin_ptr() + read_pos, readable);
+        }
+        BufferPool::get_instance()->free(buffer, cap);
+        buffer = block;
+        cap = new_cap;
+        read_pos = 0;
+        write_pos = readable;
     }
     else {
         size_t readable = readable_bytes();
         // 对缓冲区中的数据进行紧凑到头部位置
-        std::copy(begin_ptr() + read_pos, begin_ptr() + write_pos, begin_ptr());
+        memmove(begin_ptr(), begin_ptr() + read_pos, readable);
         read_pos = 0;
         write_pos = read_pos + readable;
         assert(readable == readable_bytes());
@@ -13,13 +13,22 @@
 #include <unistd.h>
 #include <sys/uio.h>
 #include <vector>
-#include <atomic>
+#include <algorithm>
 #include <assert.h>
 
+#include "buffer_pool.h"
+
+/* 缓冲区同一时刻只由一个线程访问，读写位置使用普通下标；
+ * 内存块来自 BufferPool，构造时不申请，第一次写入时才借用，
+ * 数据取空时若容量超过 high_water（默认 0，即取空就归还）则归还内存池，空闲连接不占用缓冲区内存。
+ * 解析器需要连续的可读区域，大数据通过换用更大的内存块扩容，而不是串联多个内存块 */
 class Buffer {
 public:
     Buffer(int init_size=1024);
-    ~Buffer() = default;
+    ~Buffer();
+
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
 
     size_t writeable_bytes() const;             // 获取缓冲区当前可写的字节数，即还剩多少空
     size_t readable_bytes() const;              // 获取缓冲区当前可读的字节数，即已经写了多少
@@ -46,14 +55,22 @@ public:
     ssize_t write_fd(int fd, int* Errno);
     void move_write_ptr(size_t len);
 
+    size_t capacity() const { return cap; }
+    void release();                             // 归还内存块，缓冲区中的数据被丢弃
+
+    static size_t high_water;                   // 取空时保留的最大容量，0 表示取空即归还
+
 private:
     char* begin_ptr();
     const char* begin_ptr() const;
     void adjust_space(size_t len);
+    void on_empty();
 
-    std::vector<char> buffer;                   // 缓冲区容器
-    std::atomic<std::size_t> read_pos;          // 缓冲区读取位置索引，原子对象
-    std::atomic<std::size_t> write_pos;         // 缓冲区写入位置索引，原子对象
+    char* buffer;                               // 缓冲区内存块，来自 BufferPool
+    size_t cap;
+    size_t init_size;
+    size_t read_pos;                            // 缓冲区读取位置索引
+    size_t write_pos;                           // 缓冲区写入位置索引
 };
 
 #endif
@@ -0,0 +1,109 @@
+/*
+ * @Description  : 缓冲区内存池
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 10:05:17
+ * @Last update  : 2026-10-18 10:05:17
+ */
+
+#include "buffer_pool.h"
+
+BufferPool* BufferPool::get_instance() {
+    static BufferPool pool;
+    return &pool;
+}
+
+BufferPool::~BufferPool() {
+    for(auto& list : free_list) {
+        for(char* block : list) {
+            ::free(block);
+        }
+    }
+}
+
+/* 不小于 size 的最小级别 */
+int BufferPool::class_of(size_t size) {
+    int c = 0;
+    size_t block = MIN_BLOCK;
+    while(block < size) {
+        block <<= 1;
+        c++;
+    }
+    return c;
+}
+
+/* 线程本地缓存，每级最多缓存 LOCAL_MAX 块，满时将一半归还共享池；线程退出时全部归还 */
+struct LocalCache {
+    static const size_t LOCAL_MAX = 32;
+    std::vector<char*> lists[BufferPool::CLASS_NUM];
+
+    ~LocalCache() {
+        for(int c = 0; c < BufferPool::CLASS_NUM; c++) {
+            BufferPool::get_instance()->free_shared(lists[c].data(), lists[c].size(), c);
+        }
+    }
+};
+
+static thread_local LocalCache local_cache;
+
+char* BufferPool::alloc(size_t& size) {
+    if(size > MAX_BLOCK) {
+        return static_cast<char*>(malloc(size));
+    }
+    int c = class_of(size);
+    size = MIN_BLOCK << c;
+    std::vector<char*>& list = local_cache.lists[c];
+    if(!list.empty()) {
+        char* block = list.back();
+        list.pop_back();
+        return block;
+    }
+    return alloc_shared(c);
+}
+
+void BufferPool::free(char* block, size_t size) {
+    if(!block) { return; }
+    if(size > MAX_BLOCK) {
+        ::free(block);
+        return;
+    }
+    int c = class_of(size);
+    assert(size == MIN_BLOCK << c);
+    std::vector<char*>& list = local_cache.lists[c];
+    if(list.capacity() == 0) {
+        list.reserve(LocalCache::LOCAL_MAX);
+    }
+    if(list.size() >= LocalCache::LOCAL_MAX) {
+        size_t half = LocalCache::LOCAL_MAX / 2;
+        free_shared(list.data() + half, list.size() - half, c);
+        list.resize(half);
+    }
+    list.push_back(block);
+}
+
+char* BufferPool::alloc_shared(int c) {
+    {
+        std::lock_guard<std::mutex> locker(mtx);
+        if(!free_list[c].empty()) {
+            char* block = free_list[c].back();
+            free_list[c].pop_back();
+            cached -= MIN_BLOCK << c;
+            return block;
+        }
+    }
+    return static_cast<char*>(malloc(MIN_BLOCK << c));
+}
+
+void BufferPool::free_shared(char** blocks, size_t n, int c) {
+    size_t size = MIN_BLOCK << c;
+    size_t i = 0;
+    {
+        std::lock_guard<std::mutex> locker(mtx);
+        for(; i < n && cached + size <= max_cached; i++) {
+            free_list[c].push_back(blocks[i]);
+            cached += size;
+        }
+    }
+    for(; i < n; i++) {
+        ::free(blocks[i]);
+    }
+}
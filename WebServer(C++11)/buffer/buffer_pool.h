@@ -0,0 +1,52 @@
+/*
+ * @Description  : 缓冲区内存池
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 10:05:17
+ * @Last update  : 2026-10-18 10:05:17
+ */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+
+#include <stdlib.h>
+#include <assert.h>
+#include <mutex>
+#include <vector>
+
+/* 所有连接共享的缓冲区内存池，按 2 的幂分级（1KB ~ 64KB）缓存空闲内存块，
+ * 超过最大级别的内存块直接向系统申请和释放；空闲内存总量超过上限后不再缓存。
+ * 每个线程另有一个小的本地缓存，连接按需借还内存块时大多不需要加锁 */
+class BufferPool {
+public:
+    static BufferPool* get_instance();
+
+    /* 申请至少 size 字节的内存块，size 被改写为实际大小 */
+    char* alloc(size_t& size);
+    void free(char* block, size_t size);
+
+    void set_limit(size_t max_cached_) { max_cached = max_cached_; }
+    size_t cached_bytes() const { return cached; }
+
+    static const size_t MIN_BLOCK = 1 << 10;
+    static const size_t MAX_BLOCK = 1 << 16;
+    static const int CLASS_NUM = 7;
+
+private:
+    BufferPool() : cached(0), max_cached(64 << 20) {}
+    ~BufferPool();
+
+    friend struct LocalCache;
+    char* alloc_shared(int c);
+    void free_shared(char** blocks, size_t n, int c);
+
+    static int class_of(size_t size);
+
+    std::mutex mtx;
+    std::vector<char*> free_list[CLASS_NUM];
+    size_t cached;                                      // 空闲链表中缓存的字节数
+    size_t max_cached;
+};
+
+
+#endif
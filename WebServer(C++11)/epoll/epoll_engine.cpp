@@ -0,0 +1,52 @@
+/*
+ * @Description  : epoll I/O 引擎
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-17 11:05:12
+ * @Last update  : 2026-10-17 11:05:12
+ */
+
+#include "epoll_engine.h"
+
+EpollEngine::EpollEngine(int max_event) : epoll_fd(epoll_create(512)), events(max_event){
+    assert(epoll_fd >= 0 && events.size() > 0);
+}
+
+EpollEngine::~EpollEngine() {
+    close(epoll_fd);
+}
+
+bool EpollEngine::add_fd(int fd, uint32_t events_) {
+    if(fd < 0) return false;
+    epoll_event ev = {0};
+    ev.data.fd = fd;
+    ev.events = events_;
+    return 0 == epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+bool EpollEngine::mod_fd(int fd, uint32_t events_) {
+    if(fd < 0) return false;
+    epoll_event ev = {0};
+    ev.data.fd = fd;
+    ev.events = events_;
+    return 0 == epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+bool EpollEngine::del_fd(int fd) {
+    if(fd < 0) return false;
+    epoll_event ev = {0};
+    return 0 == epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+}
+
+int EpollEngine::wait(int timeout) {
+    return epoll_wait(epoll_fd, &events[0], static_cast<int>(events.size()), timeout);
+}
+
+int EpollEngine::get_event_fd(size_t i) const {
+    assert(i < events.size() && i >= 0);
+    return events[i].data.fd;
+}
+
+uint32_t EpollEngine::get_events(size_t i) const {
+    assert(i < events.size() && i >= 0);
+    return events[i].events;
+}
@@ -0,0 +1,40 @@
+/*
+ * @Description  : epoll I/O 引擎
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-17 11:05:12
+ * @Last update  : 2026-10-17 11:05:12
+ */
+
+#ifndef EPOLL_ENGINE_H
+#define EPOLL_ENGINE_H
+
+
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <assert.h>
+#include <vector>
+
+#include "io_engine.h"
+
+class EpollEngine : public IoEngine {
+public:
+    explicit EpollEngine(int max_events);
+    ~EpollEngine() override;
+
+    bool add_fd(int fd, uint32_t events) override;
+    bool mod_fd(int fd, uint32_t events) override;
+    bool del_fd(int fd) override;
+
+    int wait(int timeout) override;
+    int get_event_fd(size_t i) const override;
+    uint32_t get_events(size_t i) const override;
+
+    const char* name() const override { return "epoll"; }
+
+private:
+    int epoll_fd;
+    std::vector<struct epoll_event> events;
+};
+
+
+#endif
@@ -2,51 +2,51 @@
  * @Description  : Epoll 封装实现
  * @Author       : Qinghe Li
  * @Create time  : 2021-07-04 20:19:35
- * @Last update  : 2021-07-04 20:21:53
+ * @Last update  : 2026-10-17 11:05:12
  */
 
 #include "epoller.h"
-
-Epoller::Epoller(int max_event) : epoll_fd(epoll_create(512)), events(max_event){
-    assert(epoll_fd >= 0 && events.size() > 0);
+#include "epoll_engine.h"
+#include "uring_engine.h"
+#include "../log/log.h"
+
+Epoller::Epoller(int max_event, int engine_type) {
+    if(engine_type == URING_ENGINE) {
+        std::unique_ptr<UringEngine> uring(new UringEngine(max_event));
+        if(uring->is_ready()) {
+            engine = std::move(uring);
+        }
+        else {
+            LOG_WARN("io_uring is not available, fall back to epoll!");
+        }
+    }
+    if(!engine) {
+        engine.reset(new EpollEngine(max_event));
+    }
 }
 
-Epoller::~Epoller() {
-    close(epoll_fd);
-}
+Epoller::~Epoller() = default;
 
 bool Epoller::add_fd(int fd, uint32_t events_) {
-    if(fd < 0) return false;
-    epoll_event ev = {0};
-    ev.data.fd = fd;
-    ev.events = events_;
-    return 0 == epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    return engine->add_fd(fd, events_);
 }
 
 bool Epoller::mod_fd(int fd, uint32_t events_) {
-    if(fd < 0) return false;
-    epoll_event ev = {0};
-    ev.data.fd = fd;
-    ev.events = events_;
-    return 0 == epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    return engine->mod_fd(fd, events_);
 }
 
 bool Epoller::del_fd(int fd) {
-    if(fd < 0) return false;
-    epoll_event ev = {0};
-    return 0 == epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+    return engine->del_fd(fd);
 }
 
 int Epoller::wait(int timeout) {
-    return epoll_wait(epoll_fd, &events[0], static_cast<int>(events.size()), timeout);
+    return engine->wait(timeout);
 }
 
 int Epoller::get_event_fd(size_t i) const {
-    assert(i < events.size() && i >= 0);
-    return events[i].data.fd;
+    return engine->get_event_fd(i);
 }
 
 uint32_t Epoller::get_events(size_t i) const {
-    assert(i < events.size() && i >= 0);
-    return events[i].events;
-}
\ No newline at end of file
+    return engine->get_events(i);
+}
@@ -2,7 +2,7 @@
  * @Description  : Epoll 封装
  * @Author       : Qinghe Li
  * @Create time  : 2021-07-04 20:19:35
- * @Last update  : 2021-07-04 20:21:53
+ * @Last update  : 2026-10-17 11:05:12
  */
 
 #ifndef EPOLLER_H
@@ -14,11 +14,15 @@
 #include <unistd.h>
 #include <assert.h>
 #include <vector>
+#include <memory>
 #include <errno.h>
 
+#include "io_engine.h"
+
+/* 事件通知封装，具体由 epoll 或 io_uring 引擎实现，io_uring 不可用时回退到 epoll */
 class Epoller {
 public:
-    explicit Epoller(int max_events = 1024);
+    explicit Epoller(int max_events = 1024, int engine_type = EPOLL_ENGINE);
     ~Epoller();
 
     bool add_fd(int fd, uint32_t events);
@@ -29,9 +33,19 @@ public:
     int get_event_fd(size_t i) const;
     uint32_t get_events(size_t i) const;
 
+    /* 完成通知，见 IoEngine */
+    bool has_completion() const { return engine->has_completion(); }
+    bool add_acceptor(int fd) { return engine->add_acceptor(fd); }
+    bool add_receiver(int fd) { return engine->add_receiver(fd); }
+    bool send(int fd, const struct iovec* iov, int cnt) { return engine->send(fd, iov, cnt); }
+    int get_op(size_t i) const { return engine->get_op(i); }
+    int get_result(size_t i) const { return engine->get_result(i); }
+    const char* get_data(size_t i) const { return engine->get_data(i); }
+
+    const char* engine_name() const { return engine->name(); }
+
 private:
-    int epoll_fd;
-    std::vector<struct epoll_event> events;
+    std::unique_ptr<IoEngine> engine;
 };
 
 
@@ -0,0 +1,62 @@
+/*
+ * @Description  : I/O 引擎接口
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-17 11:05:12
+ * @Last update  : 2026-10-17 11:05:12
+ */
+
+#ifndef IO_ENGINE_H
+#define IO_ENGINE_H
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+enum IO_ENGINE_TYPE {
+    EPOLL_ENGINE = 0,
+    URING_ENGINE,
+};
+
+/* 事件类型：就绪通知只产生 IO_POLL，其余为完成通知 */
+enum IO_OP {
+    IO_POLL = 0,
+    IO_ACCEPT,                                          // result 为新连接的 fd
+    IO_RECV,                                            // result 为读取的字节数，0 表示对端关闭
+    IO_SEND,                                            // result 为发送的字节数
+};
+
+/* 就绪事件通知引擎，事件位沿用 epoll 的定义（EPOLLIN/EPOLLOUT/EPOLLET/EPOLLONESHOT 等）
+ * 支持完成通知的引擎（io_uring）还可以由内核代为 accept/recv/send，结果随事件返回，出错时 result 为 -errno；
+ * 不支持时相应接口返回 false，调用方继续使用就绪通知 */
+class IoEngine {
+public:
+    virtual ~IoEngine() = default;
+
+    virtual bool add_fd(int fd, uint32_t events) = 0;
+    virtual bool mod_fd(int fd, uint32_t events) = 0;
+    virtual bool del_fd(int fd) = 0;
+
+    virtual int wait(int timeout) = 0;
+    virtual int get_event_fd(size_t i) const = 0;
+    virtual uint32_t get_events(size_t i) const = 0;
+
+    virtual bool has_completion() const { return false; }
+    /* multishot accept，新连接为非阻塞套接字 */
+    virtual bool add_acceptor(int fd) { return false; }
+    /* multishot recv，数据由引擎的缓冲区承载 */
+    virtual bool add_receiver(int fd) { return false; }
+    /* 发送 iov 指向的数据，完成之前调用方必须保持 iov 及其指向的数据不变，也不能 del_fd；
+     * 没有读文件的接口：响应体来自文件缓存的映射（随 iov 发送）或 sendfile，请求路径上不读文件 */
+    virtual bool send(int fd, const struct iovec* iov, int cnt) { return false; }
+
+    virtual int get_op(size_t i) const { return IO_POLL; }
+    virtual int get_result(size_t i) const { return 0; }
+    /* IO_RECV 事件的数据，下一次 wait 之前有效 */
+    virtual const char* get_data(size_t i) const { return nullptr; }
+
+    virtual const char* name() const = 0;
+};
+
+
+#endif
@@ -0,0 +1,553 @@
+/*
+ * @Description  : io_uring I/O 引擎
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-17 11:05:12
+ * @Last update  : 2026-10-17 11:05:12
+ */
+
+#include "uring_engine.h"
+#include <algorithm>
+using namespace std;
+
+/* 交给内核 poll 的事件位，去掉 epoll 专有的触发方式标志 */
+static const uint32_t POLL_MASK = EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLERR | EPOLLHUP | EPOLLRDHUP;
+
+UringEngine::UringEngine(int max_events_, unsigned entries) :
+        ring_fd(-1), sq_entries(0), multishot(true), completion(false), sqes(nullptr),
+        sq_ptr(MAP_FAILED), cq_ptr(MAP_FAILED),
+        sq_len(0), cq_len(0), sqes_len(0), local_tail(0), max_events(max_events_) {
+    assert(max_events > 0);
+    if(setup(entries)) {
+        completion = probe();
+    }
+    ready.reserve(max_events);
+}
+
+UringEngine::~UringEngine() {
+    if(sqes) { munmap(sqes, sqes_len); }
+    if(cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) { munmap(cq_ptr, cq_len); }
+    if(sq_ptr != MAP_FAILED) { munmap(sq_ptr, sq_len); }
+    if(ring_fd >= 0) { close(ring_fd); }
+}
+
+/* 创建 io_uring 并映射提交/完成队列，失败时 ring_fd 保持为 -1 */
+bool UringEngine::setup(unsigned entries) {
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = entries * 4;
+
+    int fd = syscall(__NR_io_uring_setup, entries, &p);
+    if(fd < 0) {
+        return false;
+    }
+    /* 带超时的等待需要 IORING_ENTER_EXT_ARG（5.11+） */
+    if(!(p.features & IORING_FEAT_EXT_ARG)) {
+        close(fd);
+        return false;
+    }
+
+    sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if(single_mmap) {
+        sq_len = cq_len = std::max(sq_len, cq_len);
+    }
+
+    sq_ptr = mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(sq_ptr == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    cq_ptr = single_mmap ? sq_ptr :
+             mmap(nullptr, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    sqes_len = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes_ptr = mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(cq_ptr == MAP_FAILED || sqes_ptr == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+
+    char* sq = static_cast<char*>(sq_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+
+    char* cq = static_cast<char*>(cq_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+    sq_entries = p.sq_entries;
+    local_tail = *sq_tail;
+    ring_fd = fd;
+    return true;
+}
+
+/* multishot accept（5.19）、multishot recv（6.0）、按 fd 取消（5.19）没有对应的特性位，
+ * 以 6.1 加入的 SENDMSG_ZC 是否可用来判断 */
+bool UringEngine::probe() {
+    const unsigned ops = 256;
+    std::unique_ptr<char[]> buf(new char[sizeof(io_uring_probe) + ops * sizeof(io_uring_probe_op)]());
+    io_uring_probe* p = reinterpret_cast<io_uring_probe*>(buf.get());
+    if(syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, p, ops) < 0) {
+        return false;
+    }
+    return p->ops_len > IORING_OP_SENDMSG_ZC && (p->ops[IORING_OP_SENDMSG_ZC].flags & IO_URING_OP_SUPPORTED);
+}
+
+/* to_submit 必须是实际待提交的 SQE 个数：内核提交的个数少于 to_submit 时不会等待完成事件，
+ * 事件循环会变成忙等 */
+int UringEngine::enter(unsigned to_submit, unsigned min_complete, int timeout) {
+    if(min_complete == 0) {
+        return syscall(__NR_io_uring_enter, ring_fd, to_submit, 0, 0, nullptr, 0);
+    }
+    struct __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if(timeout >= 0) {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000LL;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete,
+                   IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+io_uring_sqe* UringEngine::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if(local_tail - head >= sq_entries) {
+        /* 提交队列已满，先提交一批 */
+        enter(local_tail - head, 0, -1);
+        head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        if(local_tail - head >= sq_entries) {
+            return nullptr;
+        }
+    }
+    unsigned idx = local_tail & *sq_mask;
+    io_uring_sqe* sqe = &sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[idx] = idx;
+    local_tail++;
+    return sqe;
+}
+
+void UringEngine::prep_poll_add(int fd) {
+    FdState& st = fds[fd];
+    io_uring_sqe* sqe = get_sqe();
+    if(!sqe) {
+        rearm.push_back(fd);
+        return;
+    }
+    st.multi = multishot && (st.events & EPOLLET) && !(st.events & EPOLLONESHOT);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = st.events & POLL_MASK;
+    sqe->len = st.multi ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = make_data(fd, st.gen);
+    __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+    st.armed = true;
+}
+
+void UringEngine::prep_poll_remove(int fd) {
+    FdState& st = fds[fd];
+    io_uring_sqe* sqe = get_sqe();
+    if(!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = make_data(fd, st.gen);
+    sqe->user_data = REMOVE_DATA;
+    __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+    st.armed = false;
+}
+
+void UringEngine::prep_accept(int fd) {
+    FdState& st = fds[fd];
+    io_uring_sqe* sqe = get_sqe();
+    if(!sqe) {
+        rearm.push_back(fd);
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK;
+    sqe->user_data = make_data(fd, st.io_gen, IO_ACCEPT);
+    __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+    st.accept_armed = true;
+}
+
+/* 由内核从接收缓冲区组中挑选缓冲区，完成事件的 flags 中带有缓冲区编号 */
+void UringEngine::prep_recv(int fd) {
+    FdState& st = fds[fd];
+    io_uring_sqe* sqe = get_sqe();
+    if(!sqe) {
+        rearm.push_back(fd);
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RECV_BGID;
+    sqe->user_data = make_data(fd, st.io_gen, IO_RECV);
+    __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+    st.recv_armed = true;
+}
+
+/* 按 user_data 取消 multishot 请求：随下一次 wait 提交时 fd 可能已经关闭并被新连接复用，
+ * 按 fd 取消会误伤新连接，user_data 中的代数保证只取消旧请求 */
+void UringEngine::prep_cancel(uint64_t data) {
+    io_uring_sqe* sqe = get_sqe();
+    if(!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = data;
+    sqe->user_data = REMOVE_DATA;
+    __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+}
+
+/* 将编号从 bid 开始的 cnt 个接收缓冲区交给内核 */
+bool UringEngine::provide_buffers(unsigned bid, unsigned cnt) {
+    io_uring_sqe* sqe = get_sqe();
+    if(!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = cnt;
+    sqe->addr = reinterpret_cast<uint64_t>(recv_bufs.get() + (size_t)bid * RECV_BUF_SIZE);
+    sqe->len = RECV_BUF_SIZE;
+    sqe->off = bid;
+    sqe->buf_group = RECV_BGID;
+    sqe->user_data = REMOVE_DATA;
+    __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* 非事件循环线程（如线程池）的修改需要立即提交，否则要等到下一次 wait 返回；
+ * 提交在锁外进行，同一个 io_uring 上的并发提交由内核串行化 */
+void UringEngine::flush_if_foreign(unique_lock<mutex>& locker) {
+    if(owner != std::this_thread::get_id()) {
+        unsigned to_submit = unsubmitted();
+        locker.unlock();
+        if(to_submit > 0) { enter(to_submit, 0, -1); }
+    }
+}
+
+bool UringEngine::add_fd(int fd, uint32_t events_) {
+    if(fd < 0) return false;
+    unique_lock<mutex> locker(mtx);
+    if(static_cast<size_t>(fd) >= fds.size()) {
+        fds.resize(fd + 1);
+    }
+    FdState& st = fds[fd];
+    if(st.registered) {
+        errno = EEXIST;
+        return false;
+    }
+    st.registered = true;
+    st.events = events_;
+    st.gen++;
+    prep_poll_add(fd);
+    flush_if_foreign(locker);
+    return true;
+}
+
+bool UringEngine::mod_fd(int fd, uint32_t events_) {
+    if(fd < 0) return false;
+    unique_lock<mutex> locker(mtx);
+    if(static_cast<size_t>(fd) >= fds.size() || !fds[fd].registered) {
+        errno = ENOENT;
+        return false;
+    }
+    FdState& st = fds[fd];
+    if(st.armed && st.events == events_) {
+        return true;
+    }
+    if(st.armed) {
+        prep_poll_remove(fd);
+    }
+    st.events = events_;
+    st.gen++;
+    prep_poll_add(fd);
+    flush_if_foreign(locker);
+    return true;
+}
+
+bool UringEngine::del_fd(int fd) {
+    if(fd < 0) return false;
+    unique_lock<mutex> locker(mtx);
+    if(static_cast<size_t>(fd) >= fds.size() ||
+       !(fds[fd].registered || fds[fd].accepting || fds[fd].receiving)) {
+        errno = ENOENT;
+        return false;
+    }
+    FdState& st = fds[fd];
+    if(st.armed) {
+        prep_poll_remove(fd);
+    }
+    /* 内核中的 multishot 请求持有文件引用，不取消的话 close 之后连接不会真正关闭 */
+    if(st.accept_armed) {
+        prep_cancel(make_data(fd, st.io_gen, IO_ACCEPT));
+        st.accept_armed = false;
+    }
+    if(st.recv_armed) {
+        prep_cancel(make_data(fd, st.io_gen, IO_RECV));
+        st.recv_armed = false;
+    }
+    st.registered = st.accepting = st.receiving = false;
+    st.gen++;
+    st.io_gen++;
+    flush_if_foreign(locker);
+    return true;
+}
+
+bool UringEngine::add_acceptor(int fd) {
+    if(fd < 0 || !completion) return false;
+    unique_lock<mutex> locker(mtx);
+    if(static_cast<size_t>(fd) >= fds.size()) {
+        fds.resize(fd + 1);
+    }
+    FdState& st = fds[fd];
+    if(st.accepting) {
+        errno = EEXIST;
+        return false;
+    }
+    st.accepting = true;
+    prep_accept(fd);
+    flush_if_foreign(locker);
+    return true;
+}
+
+bool UringEngine::add_receiver(int fd) {
+    if(fd < 0 || !completion) return false;
+    unique_lock<mutex> locker(mtx);
+    if(static_cast<size_t>(fd) >= fds.size()) {
+        fds.resize(fd + 1);
+    }
+    FdState& st = fds[fd];
+    if(st.receiving) {
+        errno = EEXIST;
+        return false;
+    }
+    if(!recv_bufs) {
+        recv_bufs.reset(new char[(size_t)RECV_BUF_NUM * RECV_BUF_SIZE]);
+        if(!provide_buffers(0, RECV_BUF_NUM)) {
+            for(unsigned bid = 0; bid < RECV_BUF_NUM; bid++) {
+                recycle.push_back(bid);
+            }
+        }
+    }
+    st.receiving = true;
+    prep_recv(fd);
+    flush_if_foreign(locker);
+    return true;
+}
+
+/* 单个数据段用 SEND，多个数据段用 SENDMSG；提交队列满时返回 false，由调用方改为同步写 */
+bool UringEngine::send(int fd, const struct iovec* iov, int cnt) {
+    if(fd < 0 || !completion || cnt <= 0) return false;
+    unique_lock<mutex> locker(mtx);
+    if(static_cast<size_t>(fd) >= fds.size()) {
+        fds.resize(fd + 1);
+    }
+    FdState& st = fds[fd];
+    io_uring_sqe* sqe = get_sqe();
+    if(!sqe) {
+        return false;
+    }
+    sqe->fd = fd;
+    if(cnt == 1) {
+        sqe->opcode = IORING_OP_SEND;
+        sqe->addr = reinterpret_cast<uint64_t>(iov[0].iov_base);
+        sqe->len = iov[0].iov_len;
+    }
+    else {
+        if(!st.msg) {
+            st.msg.reset(new msghdr());
+        }
+        memset(st.msg.get(), 0, sizeof(msghdr));
+        st.msg->msg_iov = const_cast<struct iovec*>(iov);
+        st.msg->msg_iovlen = cnt;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->addr = reinterpret_cast<uint64_t>(st.msg.get());
+        sqe->len = 1;
+    }
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = make_data(fd, st.io_gen, IO_SEND);
+    __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+    flush_if_foreign(locker);
+    return true;
+}
+
+int UringEngine::wait(int timeout) {
+    ready.clear();
+    unsigned min_complete = 1;
+    unsigned to_submit = 0;
+    {
+        lock_guard<mutex> locker(mtx);
+        owner = std::this_thread::get_id();
+        /* 调用方已经处理完上一轮 recv 的数据，缓冲区归还内核，排在重新提交的 recv 之前 */
+        size_t returned = 0;
+        while(returned < recycle.size() && provide_buffers(recycle[returned], 1)) {
+            returned++;
+        }
+        recycle.erase(recycle.begin(), recycle.begin() + returned);
+        /* LT 模式：上一轮取走事件的 fd 重新提交 poll，若仍然就绪会立即再次完成；
+         * 结束了的 multishot accept/recv 也在这里重新提交 */
+        arming.swap(rearm);
+        for(int fd : arming) {
+            FdState& st = fds[fd];
+            if(st.registered && !st.armed) {
+                prep_poll_add(fd);
+            }
+            if(st.accepting && !st.accept_armed) {
+                prep_accept(fd);
+            }
+            if(st.receiving && !st.recv_armed) {
+                prep_recv(fd);
+            }
+        }
+        arming.clear();
+        /* 完成队列中还有上一轮没取完的事件时不阻塞 */
+        if(timeout == 0 || __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE) != *cq_head) {
+            min_complete = 0;
+        }
+        to_submit = unsubmitted();
+    }
+
+    /* 一次系统调用完成提交和等待；其他线程在此之前提交了这些 SQE 时内核不等待，返回 0 个事件 */
+    int ret = enter(to_submit, min_complete, timeout);
+    if(ret < 0 && errno != ETIME && errno != EBUSY) {
+        return -1;
+    }
+
+    lock_guard<mutex> locker(mtx);
+    reap();
+    return static_cast<int>(ready.size());
+}
+
+/* 从完成队列中取出事件，丢弃已经被 mod/del 作废的完成事件 */
+void UringEngine::reap() {
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    while(head != tail && ready.size() < max_events) {
+        const io_uring_cqe* cqe = &cqes[head & *cq_mask];
+        head++;
+        if(cqe->user_data == REMOVE_DATA) {
+            continue;
+        }
+        int fd = static_cast<int>(cqe->user_data & 0xffffffff);
+        uint32_t gen = static_cast<uint32_t>(cqe->user_data >> 32) & GEN_MASK;
+        int op = static_cast<int>(cqe->user_data >> 62);
+        if(static_cast<size_t>(fd) >= fds.size()) {
+            continue;
+        }
+        if(op != IO_POLL) {
+            reap_io(cqe, fd, gen, op);
+            continue;
+        }
+        FdState& st = fds[fd];
+        if(!st.registered || (st.gen & GEN_MASK) != gen) {
+            continue;
+        }
+
+        if(!(cqe->flags & IORING_CQE_F_MORE)) {
+            st.armed = false;
+        }
+        if(cqe->res < 0) {
+            if(cqe->res == -EINVAL && st.multi) {
+                /* 内核不支持 multishot poll，退化为单次 poll + 自动重新提交 */
+                multishot = false;
+                rearm.push_back(fd);
+                continue;
+            }
+            if(cqe->res == -ECANCELED) {
+                rearm.push_back(fd);
+                continue;
+            }
+            ready.push_back({fd, EPOLLERR, IO_POLL, 0, nullptr});
+        }
+        else {
+            ready.push_back({fd, static_cast<uint32_t>(cqe->res), IO_POLL, 0, nullptr});
+        }
+        if(!st.armed && !(st.events & EPOLLONESHOT)) {
+            rearm.push_back(fd);
+        }
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+}
+
+/* accept/recv/send 的完成事件，过期事件占用的接收缓冲区同样需要归还 */
+void UringEngine::reap_io(const io_uring_cqe* cqe, int fd, uint32_t gen, int op) {
+    FdState& st = fds[fd];
+    bool more = cqe->flags & IORING_CQE_F_MORE;
+    const char* data = nullptr;
+    if(cqe->flags & IORING_CQE_F_BUFFER) {
+        unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        recycle.push_back(bid);
+        data = recv_bufs.get() + (size_t)bid * RECV_BUF_SIZE;
+    }
+    if((st.io_gen & GEN_MASK) != gen) {
+        return;
+    }
+    if(op == IO_ACCEPT) {
+        if(!more) {
+            st.accept_armed = false;
+            rearm.push_back(fd);
+        }
+        if(!st.accepting || cqe->res == -ECANCELED) {
+            return;
+        }
+    }
+    else if(op == IO_RECV) {
+        if(!more) {
+            st.recv_armed = false;
+        }
+        if(!st.receiving) {
+            return;
+        }
+        /* 缓冲区用完时 recv 结束，等缓冲区归还后重新提交，不通知调用方 */
+        if(cqe->res == -ENOBUFS || cqe->res == -ECANCELED) {
+            rearm.push_back(fd);
+            return;
+        }
+        /* 读到数据但 multishot 结束（如完成队列溢出）时同样重新提交 */
+        if(!more && cqe->res > 0) {
+            rearm.push_back(fd);
+        }
+    }
+    ready.push_back({fd, 0, op, cqe->res, data});
+}
+
+int UringEngine::get_event_fd(size_t i) const {
+    assert(i < ready.size());
+    return ready[i].fd;
+}
+
+uint32_t UringEngine::get_events(size_t i) const {
+    assert(i < ready.size());
+    return ready[i].events;
+}
+
+int UringEngine::get_op(size_t i) const {
+    assert(i < ready.size());
+    return ready[i].op;
+}
+
+int UringEngine::get_result(size_t i) const {
+    assert(i < ready.size());
+    return ready[i].result;
+}
+
+const char* UringEngine::get_data(size_t i) const {
+    assert(i < ready.size());
+    return ready[i].data;
+}
@@ -0,0 +1,143 @@
+/*
+ * @Description  : io_uring I/O 引擎
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-17 11:05:12
+ * @Last update  : 2026-10-17 11:05:12
+ */
+
+#ifndef URING_ENGINE_H
+#define URING_ENGINE_H
+
+
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <memory>
+
+#include "io_engine.h"
+
+/* 基于 io_uring POLL_ADD 的就绪通知引擎：
+ * add/mod/del 只是往提交队列里放 SQE，事件循环线程内的修改在下一次 wait 时随同等待一起提交，
+ * 一次 io_uring_enter 同时完成 “epoll_ctl” 和 “epoll_wait”；其他线程的修改立即提交。
+ *   EPOLLONESHOT   -> 单次 poll，mod_fd 时重新提交
+ *   EPOLLET        -> multishot poll
+ *   LT             -> 单次 poll，事件取走后在下一次 wait 时自动重新提交
+ * 内核支持时（6.1+）还提供完成通知：
+ *   add_acceptor   -> multishot ACCEPT，每个新连接一个完成事件
+ *   add_receiver   -> multishot RECV，数据写入引擎预先提供给内核的缓冲区，取走后在下一次 wait 时归还
+ *   send           -> SEND / SENDMSG，随下一次 wait 一起提交 */
+class UringEngine : public IoEngine {
+public:
+    explicit UringEngine(int max_events, unsigned entries = 4096);
+    ~UringEngine() override;
+
+    bool is_ready() const { return ring_fd >= 0; }
+
+    bool add_fd(int fd, uint32_t events) override;
+    bool mod_fd(int fd, uint32_t events) override;
+    bool del_fd(int fd) override;
+
+    int wait(int timeout) override;
+    int get_event_fd(size_t i) const override;
+    uint32_t get_events(size_t i) const override;
+
+    bool has_completion() const override { return completion; }
+    bool add_acceptor(int fd) override;
+    bool add_receiver(int fd) override;
+    bool send(int fd, const struct iovec* iov, int cnt) override;
+
+    int get_op(size_t i) const override;
+    int get_result(size_t i) const override;
+    const char* get_data(size_t i) const override;
+
+    const char* name() const override { return "io_uring"; }
+
+private:
+    struct FdState {
+        uint32_t events = 0;                            // 注册的 epoll 事件
+        uint32_t gen = 0;                               // 每次 mod/del 递增，用于丢弃过期的 poll 完成事件
+        uint32_t io_gen = 0;                            // 每次 del 递增，用于丢弃过期的 accept/recv/send 完成事件
+        bool registered = false;
+        bool armed = false;                             // 内核中是否有该 fd 的 poll 请求
+        bool multi = false;                             // 当前 poll 是否为 multishot
+        bool accepting = false;
+        bool receiving = false;
+        bool accept_armed = false;
+        bool recv_armed = false;
+        std::unique_ptr<msghdr> msg;                    // SENDMSG 的参数，fds 扩容时地址不变
+    };
+
+    struct Event {
+        int fd;
+        uint32_t events;
+        int op;
+        int result;
+        const char* data;
+    };
+
+    bool setup(unsigned entries);
+    bool probe();
+    int enter(unsigned to_submit, unsigned min_complete, int timeout);
+
+    /* 以下函数需持有 mtx */
+    unsigned unsubmitted() const { return local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE); }
+    io_uring_sqe* get_sqe();
+    void prep_poll_add(int fd);
+    void prep_poll_remove(int fd);
+    void prep_accept(int fd);
+    void prep_recv(int fd);
+    void prep_cancel(uint64_t data);
+    bool provide_buffers(unsigned bid, unsigned cnt);
+    void flush_if_foreign(std::unique_lock<std::mutex>& locker);
+    void reap();
+    void reap_io(const io_uring_cqe* cqe, int fd, uint32_t gen, int op);
+
+    /* user_data：高 2 位为事件类型，接着 30 位代数，低 32 位为 fd */
+    static uint64_t make_data(int fd, uint32_t gen, int op = IO_POLL) {
+        return (uint64_t)op << 62 | (uint64_t)(gen & GEN_MASK) << 32 | (uint32_t)fd;
+    }
+    static const uint32_t GEN_MASK = 0x3fffffff;
+    static const uint64_t REMOVE_DATA = ~0ULL;          // 不需要处理的完成事件（poll 移除、取消、归还缓冲区）
+
+    static const unsigned RECV_BUF_NUM = 512;           // 接收缓冲区个数
+    static const unsigned RECV_BUF_SIZE = 4096;
+    static const unsigned RECV_BGID = 1;                // 接收缓冲区组
+
+    int ring_fd;
+    unsigned sq_entries;
+    bool multishot;                                     // 内核是否支持 multishot poll
+    bool completion;                                    // 内核是否支持 multishot accept/recv
+
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    io_uring_sqe* sqes;
+    io_uring_cqe* cqes;
+    void* sq_ptr;
+    void* cq_ptr;
+    size_t sq_len, cq_len, sqes_len;
+    unsigned local_tail;
+
+    std::mutex mtx;                                     // 保护提交队列与 fd 状态
+    std::thread::id owner;                              // 调用 wait 的事件循环线程
+    std::vector<FdState> fds;
+    std::vector<int> rearm;                             // 等待重新提交的 LT fd
+    std::vector<int> arming;
+
+    std::unique_ptr<char[]> recv_bufs;                  // 首次 add_receiver 时分配
+    std::vector<unsigned> recycle;                      // 上一轮取走的接收缓冲区，下一次 wait 时归还内核
+
+    size_t max_events;
+    std::vector<Event> ready;
+};
+
+
+#endif
@@ -15,6 +15,9 @@ bool HttpConn::is_ET;
 HttpConn::HttpConn() {
     fd = -1;
     addr = {0};
+    out_head = out_count = out_bytes = 0;
+    keep_alive = false;
+    verify_state = VERIFY_NONE;
     is_close = true;
 };
 
@@ -28,6 +31,9 @@ void HttpConn::init(int sock_fd, const sockaddr_in& addr_) {
     user_count++;
     addr = addr_;
     fd = sock_fd;
+    clear_queue();
+    keep_alive = true;
+    verify_state = VERIFY_NONE;
     buffer_write.retrieve_all();
     buffer_read.retrieve_all();
     is_close = false;
@@ -37,7 +43,10 @@ void HttpConn::init(int sock_fd, const sockaddr_in& addr_) {
 
 /* 关闭连接 */
 void HttpConn::Close() {
-    response.unmap_file();
+    response.close_file();
+    clear_queue();
+    buffer_read.release();
+    buffer_write.release();
     if(!is_close){
         is_close = true;
         user_count--;
@@ -76,62 +85,152 @@ ssize_t HttpConn::read(int* save_errno) {
     return len;
 }
 
-/* 写方法,响应头和响应体分开传输 */
+/* 写方法：队首响应体需要 sendfile 时单独发送，否则将队列中的响应头和映射的响应体合并为一次 writev */
 ssize_t HttpConn::write(int* save_errno) {
     ssize_t len = -1;
     do {
-        len = writev(fd, iov, iov_count);
-        if(len <= 0) {
-            *save_errno = errno;
-            break;
-        }
-        if(iov[0].iov_len + iov[1].iov_len  == 0) {
+        if(out_count == 0) {
             break;                                                              // 传输结束
         }
-        else if(static_cast<size_t>(len) > iov[0].iov_len) {
-            iov[1].iov_base = (uint8_t*) iov[1].iov_base + (len - iov[0].iov_len);
-            iov[1].iov_len -= (len - iov[0].iov_len);
-            if(iov[0].iov_len) {
-                buffer_write.retrieve_all();
-                iov[0].iov_len = 0;
+        Pending& front = out[out_head];
+        if(front.head_len == 0 && front.file && !front.file->data) {
+            off_t offset = front.body_off;
+            len = sendfile(fd, front.file->fd, &offset, front.body_len - front.body_off);
+            if(len <= 0) {
+                *save_errno = (len == 0) ? EIO : errno;                         // 文件被截断，无法再发送
+                len = -1;
+                break;
             }
         }
         else {
-            iov[0].iov_base = (uint8_t*)iov[0].iov_base + len;
-            iov[0].iov_len -= len;
-            buffer_write.retrieve(len);
+            len = writev(fd, iov, fill_iov());
+            if(len <= 0) {
+                *save_errno = errno;
+                break;
+            }
         }
+        consume(len);
     } while(is_ET || to_write_bytes() > 10240);
     return len;
 }
 
-/* 处理方法：解析读缓存内的请求报文，判断是否完整 */
-// 不完整返回 false，完整在写缓存内写入响应头，并获取响应体内容（文件）
+int HttpConn::send_iov(const struct iovec** iov_) {
+    *iov_ = iov;
+    return fill_iov();
+}
+
+/* 按顺序收集待发送的数据段，遇到需要 sendfile 的响应体时截止 */
+int HttpConn::fill_iov() {
+    int cnt = 0;
+    const char* head = buffer_write.read_ptr();
+    for(size_t i = 0; i < out_count && cnt + 2 <= MAX_IOV; i++) {
+        const Pending& p = out[(out_head + i) % MAX_PIPELINE];
+        if(p.head_len > 0) {
+            iov[cnt].iov_base = const_cast<char*>(head);
+            iov[cnt].iov_len = p.head_len;
+            head += p.head_len;
+            cnt++;
+        }
+        if(p.body_off < p.body_len) {
+            if(!p.file->data) { break; }
+            iov[cnt].iov_base = p.file->data + p.body_off;
+            iov[cnt].iov_len = p.body_len - p.body_off;
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
+/* 从队首开始扣除已发送的 len 字节，发送完的响应出队 */
+void HttpConn::consume(size_t len) {
+    assert(len <= out_bytes);
+    out_bytes -= len;
+    while(out_count > 0) {
+        Pending& p = out[out_head];
+        size_t n = min(len, p.head_len);
+        buffer_write.retrieve(n);
+        p.head_len -= n;
+        len -= n;
+        n = min(len, p.body_len - p.body_off);
+        p.body_off += n;
+        len -= n;
+        if(p.head_len > 0 || p.body_off < p.body_len) {
+            break;
+        }
+        p.file.reset();
+        out_head = (out_head + 1) % MAX_PIPELINE;
+        out_count--;
+    }
+    if(out_count == 0) {
+        buffer_write.retrieve_all();
+    }
+}
+
+void HttpConn::clear_queue() {
+    for(Pending& p : out) {
+        p.file.reset();
+    }
+    out_head = out_count = out_bytes = 0;
+}
+
+/* 处理方法：依次解析读缓存内所有完整的请求，响应按请求顺序排队 */
+// 返回是否有待发送的响应；请求不完整时留在读缓存中等待后续数据
 bool HttpConn::process() {
-    // request.init();
-    if(buffer_read.readable_bytes() <= 0) {
-        return false;
+    if(verify_state != VERIFY_NONE) {
+        return out_bytes > 0;                                                   // 等待数据库结果
     }
-    else if(request.parse(buffer_read)) {
-        LOG_DEBUG("%s", request.get_path().c_str());
-        response.init(src_dir, request.get_path(), request.is_keep_alive(), 200);
-        request.init(); // 如果是长连接，等待下一次请求，需要初始化
-    } else {
-        response.init(src_dir, request.get_path(), false, 400);
+    /* 不保持连接的响应之后的请求不再处理 */
+    while(out_count < MAX_PIPELINE && (keep_alive || out_count == 0) && buffer_read.readable_bytes() > 0) {
+        HTTP_CODE ret = request.parse(buffer_read);
+        if(ret == NO_REQUEST) {
+            break;                                                              // 请求不完整，继续读
+        }
+        else if(ret == GET_REQUEST) {
+            LOG_DEBUG("%s", request.get_path().c_str());
+            if(request.need_verify()) {
+                /* 前面还有响应未发送时先发送，之后重新解析该请求，保证结果返回时只剩这一个请求待处理 */
+                if(out_count > 0) {
+                    request.init();
+                }
+                else {
+                    verify_state = VERIFY_READY;
+                }
+                break;
+            }
+            response.init(src_dir, request.get_path(), request.is_keep_alive(), 200);
+            buffer_read.retrieve(request.request_size());
+        } else {
+            response.init(src_dir, request.get_path(), false, 400);
+            buffer_read.retrieve_all();                                         // 错误请求无法定位下一个请求的起点
+        }
+        queue_response();
     }
+    return out_bytes > 0;
+}
+
+/* 数据库结果返回后为暂停的请求生成响应，调用方随后再次调用 process 处理之后的请求 */
+void HttpConn::finish_verify(bool pass) {
+    assert(verify_state == VERIFY_WAITING);
+    verify_state = VERIFY_NONE;
+    request.set_verified(pass);
+    response.init(src_dir, request.get_path(), request.is_keep_alive(), 200);
+    buffer_read.retrieve(request.request_size());
+    queue_response();
+}
 
+/* 生成响应并加入发送队列 */
+void HttpConn::queue_response() {
+    request.init(); // 如果是长连接，等待下一次请求，需要初始化
+
+    size_t before = buffer_write.readable_bytes();
     response.make_response(buffer_write);
-    /* 响应头 */
-    iov[0].iov_base = const_cast<char*>(buffer_write.read_ptr());
-    iov[0].iov_len = buffer_write.readable_bytes();
-    iov_count = 1;
-
-    /* 文件 */
-    if(response.file_len() > 0  && response.file()) {
-        iov[1].iov_base = response.file();
-        iov[1].iov_len = response.file_len();
-        iov_count = 2;
-    }
-    LOG_DEBUG("filesize:%d, %d  to %d", response.file_len() , iov_count, to_write_bytes());
-    return true;
-}
\ No newline at end of file
+    Pending& p = out[(out_head + out_count) % MAX_PIPELINE];
+    p.head_len = buffer_write.readable_bytes() - before;
+    p.file = response.take_file();
+    p.body_off = 0;
+    p.body_len = p.file ? p.file->size : 0;
+    out_count++;
+    out_bytes += p.head_len + p.body_len;
+    keep_alive = response.keep_alive();
+    LOG_DEBUG("filesize:%zu, queued:%zu, to %zu", p.body_len, out_count, out_bytes);
+}
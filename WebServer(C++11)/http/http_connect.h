@@ -11,9 +11,11 @@
 
 #include <sys/types.h>
 #include <sys/uio.h>
+#include <sys/sendfile.h>
 #include <arpa/inet.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <limits.h>
 
 #include "../log/log.h"
 #include "../pool/sql_connection_pool.h"
@@ -39,14 +41,46 @@ public:
     bool process();
     void Close();
 
-    int to_write_bytes() {
-        return iov[0].iov_len + iov[1].iov_len;
+    /* 完成通知：内核读到的数据追加到读缓冲区 */
+    void feed(const char* data, size_t len) {
+        buffer_read.append(data, len);
     }
 
+    /* 完成通知：交给内核发送的数据段，返回 0 表示队首响应体需要 sendfile；
+     * 发送完成（finish_send）之前 iov 和写缓冲区保持不变 */
+    int send_iov(const struct iovec** iov_);
+
+    void finish_send(size_t len) {
+        consume(len);
+    }
+
+    size_t to_write_bytes() {
+        return out_bytes;
+    }
+
+    /* 最后一个已排队的响应是否保持连接 */
     bool is_keep_alive() const {
-        return request.is_keep_alive();
+        return keep_alive;
+    }
+
+    bool is_closed() const {
+        return is_close;
+    }
+
+    /* process 遇到登录/注册请求时暂停处理，返回 true 一次，由调用方提交数据库任务；
+     * 等待结果期间 process 不再解析后续请求，结果通过 finish_verify 填回并生成响应 */
+    bool take_verify() {
+        if(verify_state != VERIFY_READY) { return false; }
+        verify_state = VERIFY_WAITING;
+        return true;
     }
 
+    const HttpRequest& get_request() const {
+        return request;
+    }
+
+    void finish_verify(bool pass);
+
     static bool is_ET;
     static const char* src_dir;
     static std::atomic<int> user_count;
@@ -55,8 +89,32 @@ private:
     int fd;
     struct  sockaddr_in addr;
 
-    int iov_count;
-    struct iovec iov[2];
+    /* 按请求顺序排队的响应，响应头依次存放在 buffer_write 中 */
+    struct Pending {
+        size_t head_len;                                // 响应头（含错误页面）剩余未发送的字节数
+        FileRef file;                                   // 响应体文件，发送完之前持有缓存条目
+        size_t body_off;                                // 响应体已发送的字节数
+        size_t body_len;
+    };
+
+    static const int MAX_PIPELINE = 16;                 // 单个连接最多排队的响应数，其余请求留在读缓冲区
+    static const int MAX_IOV = MAX_PIPELINE * 2;
+    static_assert(MAX_IOV <= IOV_MAX, "too many iovecs");
+
+    int fill_iov();
+    void consume(size_t len);
+    void clear_queue();
+    void queue_response();
+
+    enum VERIFY_STATE { VERIFY_NONE, VERIFY_READY, VERIFY_WAITING };
+    VERIFY_STATE verify_state;
+
+    Pending out[MAX_PIPELINE];
+    size_t out_head;
+    size_t out_count;
+    size_t out_bytes;                                   // 队列中剩余未发送的总字节数
+    bool keep_alive;
+    struct iovec iov[MAX_IOV];
 
     Buffer buffer_read;                                 // 读缓冲区
     Buffer buffer_write;                                // 写缓冲区
@@ -6,9 +6,13 @@
  */
 
 #include "http_request.h"
+#include "../pool/sql_executor.h"
+#include "../pool/user_writer.h"
 using namespace std;
 
-const char CRLF[] = "\r\n";
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 const unordered_set<string> HttpRequest::DEFAULT_HTML {
         "/index", "/sign", "/login",
@@ -21,77 +25,92 @@ const unordered_map<string, int> HttpRequest::DEFAULT_HTML_TAG {
 };
 
 void HttpRequest::init() {
-    method = path = version = body = "";
     state = REQUEST_LINE;
+    base = nullptr;
+    line_start = scan_pos = body_start = parsed = 0;
+    method = version = {0, 0};
+    path.clear();
+    fields.clear();
     linger = false;
     content_len = 0;
-    header.clear();
     post.clear();
+    verify_tag = -1;
 }
 
 bool HttpRequest::is_keep_alive() const {
-    if (header.count("Connection"))
-        return linger;
-    return false;
+    return linger;
 }
 
-HTTP_CODE HttpRequest::parse(Buffer& buff) {
-    while(buff.readable_bytes()) {
-        const char* line_end;
-        std::string line;
-        // 除了消息体外，逐行解析
-        if(state != BODY) {
-            // search，找到返回第一个字符串下标，找不到返回最后一下标
-            line_end = search(buff.read_ptr(), buff.write_ptr_const(), CRLF, CRLF + 2);
-            // 如果没找到 CRLF，也不是 BODY，那么一定不完整
-            if (line_end == buff.write_ptr())
-                return NO_REQUEST;
-            line = string(buff.read_ptr(), line_end);
-            buff.retrieve_until(line_end + 2); // 除消息体外，都有换行符
+/* 查找换行符，AVX2/SSE2 一次比较 32/16 字节，剩余部分及不支持的平台逐字节查找 */
+const char* HttpRequest::find_lf(const char* p, const char* end) {
+#if defined(__AVX2__)
+    const __m256i lf32 = _mm256_set1_epi8('\n');
+    for(; end - p >= 32; p += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, lf32)));
+        if(mask) { return p + __builtin_ctz(mask); }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i lf16 = _mm_set1_epi8('\n');
+    for(; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, lf16)));
+        if(mask) { return p + __builtin_ctz(mask); }
+    }
+#endif
+    for(; p < end; p++) {
+        if(*p == '\n') { return p; }
+    }
+    return nullptr;
+}
+
+bool HttpRequest::iequals(string_view a, string_view b) {
+    if(a.size() != b.size()) { return false; }
+    for(size_t i = 0; i < a.size(); i++) {
+        if(tolower(static_cast<unsigned char>(a[i])) != tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
         }
-        else {
-            // 消息体读取全部内容，同时清空缓存
-            body += buff.retrieve_all_to_str();
-            if (body.size() < content_len) {
+    }
+    return true;
+}
+
+/* 逐行解析请求行和请求头，行尾为 CRLF（兼容单独的 LF），消息体按 Content-Length 等待接收完整 */
+HTTP_CODE HttpRequest::parse(Buffer& buff) {
+    base = buff.read_ptr();
+    size_t avail = buff.readable_bytes();
+    while(state != FINISH) {
+        if(state == BODY) {
+            if(avail - body_start < content_len) {
                 return NO_REQUEST;
             }
+            parsed = body_start + content_len;
+            state = FINISH;
+            return parse_body();
         }
-        switch(state)
-        {
-            case REQUEST_LINE:
-            {
-                HTTP_CODE ret = parse_request_line(line);
-                if(ret == BAD_REQUEST) {
-                    return BAD_REQUEST;
-                }
-                parse_path();
-                break;
-            }
-            case HEADERS:
-            {
-                HTTP_CODE ret = parse_header(line);
-                if(ret == GET_REQUEST) {
-                    return GET_REQUEST;
-                }
-                break;
-            }
-            case BODY:
-            {
-                HTTP_CODE ret = parse_body();
-                if(ret == GET_REQUEST) {
-                    return GET_REQUEST;
-                }
-                break;
-            }
-            default:
-                break;
+        const char* lf = find_lf(base + scan_pos, base + avail);
+        if(!lf) {
+            scan_pos = avail;
+            // 缓存读空了，但请求还不完整，继续读
+            return avail > MAX_HEAD_SIZE ? BAD_REQUEST : NO_REQUEST;
+        }
+        size_t line_end = lf - base;
+        size_t start = line_start;
+        size_t len = line_end - start;
+        if(len > 0 && base[line_end - 1] == '\r') { len--; }
+        line_start = scan_pos = line_end + 1;
+        if(line_start > MAX_HEAD_SIZE) {
+            return BAD_REQUEST;
+        }
+
+        HTTP_CODE ret = (state == REQUEST_LINE) ? parse_request_line(start, len) : parse_header(start, len);
+        if(ret == BAD_REQUEST) {
+            return BAD_REQUEST;
         }
     }
-    LOG_DEBUG("state: %d", (int)state);
-    LOG_DEBUG("content length: %d", content_len);
-    LOG_DEBUG("[%s], [%s], [%s]", method.c_str(), path.c_str(), version.c_str());
-    // 缓存读空了，但请求还不完整，继续读
-    return NO_REQUEST;
+    LOG_DEBUG("[%.*s], [%s], [%.*s]", (int)method.len, base + method.off, path.c_str(),
+              (int)version.len, base + version.off);
+    return GET_REQUEST;
 }
 
 /* 解析地址 */
@@ -103,174 +122,284 @@ void HttpRequest::parse_path() {
     }
 }
 
-/* 解析请求行 */
-HTTP_CODE HttpRequest::parse_request_line(const string& line) {
-    regex patten("^([^ ]*) ([^ ]*) HTTP/([^ ]*)$");
-    smatch sub_match;
-    if(regex_match(line, sub_match, patten)) {
-        method = sub_match[1];
-        path = sub_match[2];
-        version = sub_match[3];
-        state = HEADERS;
-        return NO_REQUEST;
+/* 解析请求行：METHOD SP PATH SP HTTP/VERSION */
+HTTP_CODE HttpRequest::parse_request_line(size_t start, size_t len) {
+    if(len == 0) {
+        return NO_REQUEST;                              // 请求行之前的空行忽略
+    }
+    string_view line(base + start, len);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = (sp1 == string_view::npos) ? sp1 : line.find(' ', sp1 + 1);
+    if(sp2 == string_view::npos || sp1 == 0 || sp2 == sp1 + 1 ||
+       line.compare(sp2 + 1, 5, "HTTP/") != 0 || line.find(' ', sp2 + 1) != string_view::npos) {
+        LOG_ERROR("RequestLine Error");
+        return BAD_REQUEST;
     }
-    LOG_ERROR("RequestLine Error");
-    return BAD_REQUEST;
+    method = {static_cast<uint32_t>(start), static_cast<uint32_t>(sp1)};
+    version = {static_cast<uint32_t>(start + sp2 + 6), static_cast<uint32_t>(len - sp2 - 6)};
+    path.assign(line.data() + sp1 + 1, sp2 - sp1 - 1);
+    parse_path();
+    linger = view(version) == "1.1";                  // HTTP/1.1 默认长连接，HTTP/1.0 需要 Connection: keep-alive
+    state = HEADERS;
+    return NO_REQUEST;
 }
 
-/* 解析请求头 */
-HTTP_CODE HttpRequest::parse_header(const string& line) {
-    regex patten("^([^:]*): ?(.*)$");
-    smatch sub_match;
-    if(regex_match(line, sub_match, patten)) {
-        header[sub_match[1]] = sub_match[2];
-        if (sub_match[1] == "Connection")
-            linger = (sub_match[2] == "keep-alive");
-        if (sub_match[1] == "Content-Length") {
-            content_len = stoi(sub_match[2]);
+/* 解析请求头：NAME ":" OWS VALUE OWS，空行表示请求头结束 */
+HTTP_CODE HttpRequest::parse_header(size_t start, size_t len) {
+    if(len == 0) {
+        if(content_len) {
+            state = BODY;
+            body_start = line_start;
+        }
+        else {
+            state = FINISH;
+            parsed = line_start;
         }
         return NO_REQUEST;
     }
-    else if(content_len) {
-        state = BODY;
-        return NO_REQUEST;
+    string_view line(base + start, len);
+    size_t colon = line.find(':');
+    if(colon == string_view::npos || colon == 0) {
+        LOG_ERROR("Header Error");
+        return BAD_REQUEST;
     }
-    else {
-        return GET_REQUEST;
+    size_t vbeg = colon + 1, vend = len;
+    while(vbeg < vend && (line[vbeg] == ' ' || line[vbeg] == '\t')) { vbeg++; }
+    while(vend > vbeg && (line[vend - 1] == ' ' || line[vend - 1] == '\t')) { vend--; }
+
+    Field field = {{static_cast<uint32_t>(start), static_cast<uint32_t>(colon)},
+                   {static_cast<uint32_t>(start + vbeg), static_cast<uint32_t>(vend - vbeg)}};
+    fields.push_back(field);
+
+    string_view name = view(field.name), value = view(field.value);
+    if(iequals(name, "Connection")) {
+        if(iequals(value, "keep-alive")) { linger = true; }
+        else if(iequals(value, "close")) { linger = false; }
+    }
+    else if(iequals(name, "Content-Length")) {
+        size_t n = 0;
+        for(char ch : value) {
+            if(ch < '0' || ch > '9' || n > MAX_BODY_SIZE) {
+                LOG_ERROR("Content-Length Error");
+                return BAD_REQUEST;
+            }
+            n = n * 10 + (ch - '0');
+        }
+        if(value.empty() || n > MAX_BODY_SIZE) {
+            LOG_ERROR("Content-Length Error");
+            return BAD_REQUEST;
+        }
+        content_len = n;
     }
+    return NO_REQUEST;
 }
 
 /* 解析请求消息体，根据消息类型解析内容 */
 HTTP_CODE HttpRequest::parse_body() {
-    if (method == "POST" && header["Content-Type"] == "application/x-www-form-urlencoded")
+    string_view body(base + body_start, content_len);
+    string_view type = get_header("Content-Type");
+    if (get_method() == "POST" && type.substr(0, 33) == "application/x-www-form-urlencoded")
     {
-        parse_from_url(); // 解析post请求数据
+        parse_from_url(body); // 解析post请求数据
         if (DEFAULT_HTML_TAG.count(path))
         {
             // tag=1:login, tag=0:sign
-            int tag = DEFAULT_HTML_TAG.find(path)->second;
-            LOG_DEBUG("Tag:%d", tag);
-            if (user_verify(post["username"], post["password"], tag)) {
-                LOG_INFO("Success!");
-                path = "/welcome.html";
-            }
-            else if(tag == 1){
-                LOG_INFO("Login failed!");
-                path = "/login_error.html";
-            }
-            else {
-                LOG_INFO("Sign failed!");
-                path = "/sign_error.html";
-            }
+            verify_tag = DEFAULT_HTML_TAG.find(path)->second;
+            LOG_DEBUG("Tag:%d", verify_tag);
         }
     }
-    LOG_DEBUG("Body:%s len:%d", body.c_str(), body.size());
+    LOG_DEBUG("Body:%.*s len:%zu", (int)body.size(), body.data(), body.size());
     return GET_REQUEST;
 }
 
 int HttpRequest::convert_hex(char ch) {
+    if(ch >= '0' && ch <= '9') return ch - '0';
     if(ch >= 'A' && ch <= 'F') return ch -'A' + 10;
     if(ch >= 'a' && ch <= 'f') return ch -'a' + 10;
-    return ch;
+    return -1;
 }
 
-/* 解析 urlEncoded 类型数据 */
-void HttpRequest::parse_from_url() {
-    if(body.size() == 0) return;
-
+/* 解析 urlEncoded 类型数据：key=value&key=value，'+' 为空格，%XX 为转义字符 */
+void HttpRequest::parse_from_url(string_view body) {
     string key, value;
-    int num = 0;
-    int n = body.size();
-    int i = 0, j = 0;
-
-    for(; i < n; i++) {
-        char ch = body[i];
-        switch (ch) {
-            case '=':
-                key = body.substr(j, i - j);
-                j = i + 1;
-                break;
-            case '+':
-                body[i] = ' ';
-                break;
-            case '%':
-                num = convert_hex(body[i + 1]) * 16 + convert_hex(body[i + 2]);
-                body[i + 2] = num % 10 + '0';
-                body[i + 1] = num / 10 + '0';
-                i += 2;
-                break;
-            case '&':
-                value = body.substr(j, i - j);
-                j = i + 1;
-                post[key] = value;
+    string* cur = &key;
+    for(size_t i = 0; i <= body.size(); i++) {
+        if(i == body.size() || body[i] == '&') {
+            if(!key.empty()) {
                 LOG_DEBUG("%s = %s", key.c_str(), value.c_str());
-                break;
-            default:
-                break;
+                post[key] = value;
+            }
+            key.clear();
+            value.clear();
+            cur = &key;
+            continue;
+        }
+        char ch = body[i];
+        if(ch == '=' && cur == &key) {
+            cur = &value;
+        }
+        else if(ch == '+') {
+            cur->push_back(' ');
+        }
+        else if(ch == '%' && i + 2 < body.size() && convert_hex(body[i + 1]) >= 0 && convert_hex(body[i + 2]) >= 0) {
+            cur->push_back(static_cast<char>(convert_hex(body[i + 1]) * 16 + convert_hex(body[i + 2])));
+            i += 2;
+        }
+        else {
+            cur->push_back(ch);
         }
-    }
-    assert(j <= i);
-    if(!post.count(key) && j < i) {
-        value = body.substr(j, i - j);
-        post[key] = value;
     }
 }
 
-bool HttpRequest::user_verify(const string &name, const string &pwd, bool is_login) {
-    if(name == "" || pwd == "") { return false; }
-    LOG_INFO("Verify name:%s pwd:%s", name.c_str(), pwd.c_str());
-    MYSQL* sql;
-    SqlConnRAII(&sql,  SqlConnPool::get_instance());
-    assert(sql);
+string HttpRequest::get_post(const string& key) const {
+    auto it = post.find(key);
+    return it == post.end() ? string() : it->second;
+}
 
-    bool flag = false;
-    char order[256] = { 0 };
-    MYSQL_RES *res = nullptr;
+void HttpRequest::set_verified(bool pass) {
+    if(pass) {
+        LOG_INFO("Success!");
+        path = "/welcome.html";
+    }
+    else if(verify_tag == 1) {
+        LOG_INFO("Login failed!");
+        path = "/login_error.html";
+    }
+    else {
+        LOG_INFO("Sign failed!");
+        path = "/sign_error.html";
+    }
+    verify_tag = -1;
+}
 
-    if(!is_login) { flag = true; }
-    /* 查询用户及密码 */
-    snprintf(order, 256, "SELECT username, passwd FROM user WHERE username='%s' LIMIT 1", name.c_str());
-    LOG_DEBUG("%s", order);
+/* 用户名确认不存在后写入：启用 UserWriter 时登记后批量写入，否则直接 INSERT */
+static void add_user(MYSQL* sql, const string& name, const string& pwd, const function<void(bool pass)>& done) {
+    UserWriter::RESERVE state = UserWriter::get_instance()->reserve(name, pwd, done);
+    if(state == UserWriter::RESERVED) { return; }
+    if(state == UserWriter::DUPLICATE) {
+        done(false);
+        return;
+    }
+    bool pass = HttpRequest::user_insert(sql, name, pwd);
+    if(pass) {
+        UserCache::get_instance()->invalidate(name);
+        UserFilter::get_instance()->add(name);
+    }
+    done(pass);
+}
 
-    if(mysql_query(sql, order)) {
-        mysql_free_result(res);
-        return false;
+bool HttpRequest::verify_async(const string& name, const string& pwd, bool is_login,
+                               const function<void(bool pass)>& done) {
+    SqlExecutor* executor = SqlExecutor::get_instance();
+    UserCache* cache = UserCache::get_instance();
+    if(name == "" || pwd == "") {
+        done(false);
+        return true;
     }
-    res = mysql_store_result(sql);
-
-    while(MYSQL_ROW row = mysql_fetch_row(res)) {
-        LOG_DEBUG("MYSQL ROW: %s %s", row[0], row[1]);
-        string password(row[1]);
-        if(is_login) {
-            if(pwd == password) {
-                flag = true;
-            }
-            else {
-                flag = false;
-                LOG_DEBUG("pwd error!");
+    if(!is_login) {
+        /* 过滤器判定用户名一定不存在且启用了批量写入时，直接登记，不经过数据库线程 */
+        bool check = UserFilter::get_instance()->maybe_contains(name);
+        if(!check) {
+            UserWriter::RESERVE state = UserWriter::get_instance()->reserve(name, pwd, done);
+            if(state == UserWriter::RESERVED) { return true; }
+            if(state == UserWriter::DUPLICATE) {
+                done(false);
+                return true;
             }
         }
-        else {
-            flag = false;
-            LOG_DEBUG("user used!");
-        }
+        return executor->submit([=](MYSQL* sql) {
+            if(check) {
+                UserRecord record;
+                if(!user_lookup(sql, name, record) || record.exists) {
+                    done(false);
+                    return;
+                }
+            }
+            add_user(sql, name, pwd, done);
+        });
     }
-    mysql_free_result(res);
-
-    if(!is_login && flag) {
-        LOG_DEBUG("regirster!");
-        bzero(order, 256);
-        snprintf(order, 256,"INSERT INTO user(username, passwd) VALUES('%s','%s')", name.c_str(), pwd.c_str());
-        LOG_DEBUG( "%s", order);
-        if(mysql_query(sql, order)) {
-            LOG_DEBUG( "Insert error!");
-            flag = false;
-        }
-        flag = true;
+
+    UserRecord record;
+    auto check = [pwd, done](bool ok, const UserRecord& record) {
+        done(ok && record.exists && record.passwd == pwd);
+    };
+    if(UserWriter::get_instance()->find(name, record)) {                 // 已注册、等待写入数据库
+        check(true, record);
+        return true;
+    }
+    UserCache::LOOKUP state = cache->lookup(name, record, check);
+    if(state == UserCache::HIT) {
+        check(true, record);
+        return true;
+    }
+    if(state == UserCache::WAIT) { return true; }
+
+    bool submitted = executor->submit([=](MYSQL* sql) {
+        UserRecord loaded;
+        bool ok = user_lookup(sql, name, loaded);
+        cache->complete(name, ok, loaded);
+        check(ok, loaded);
+    });
+    if(!submitted) {
+        cache->complete(name, false, record);                           // 等待中的请求按失败处理
+    }
+    return submitted;
+}
+
+/* 使用连接上缓存的预处理语句，用户名和密码作为参数绑定，不再拼接 SQL */
+bool HttpRequest::user_lookup(MYSQL* sql, const string& name, UserRecord& record) {
+    if(!sql) { return false; }
+    SqlStmtCache* stmts = SqlConnPool::get_instance()->get_stmts(sql);
+    if(!stmts) { return false; }
+
+    MYSQL_BIND param;
+    unsigned long name_len = name.size();
+    memset(&param, 0, sizeof(param));
+    param.buffer_type = MYSQL_TYPE_STRING;
+    param.buffer = const_cast<char*>(name.data());
+    param.buffer_length = name_len;
+    param.length = &name_len;
+
+    char password[256];
+    unsigned long password_len = 0;
+    MYSQL_BIND result;
+    memset(&result, 0, sizeof(result));
+    result.buffer_type = MYSQL_TYPE_STRING;
+    result.buffer = password;
+    result.buffer_length = sizeof(password);
+    result.length = &password_len;
+
+    int found = stmts->execute(STMT_SELECT_USER, &param, &result);
+    if(found < 0) { return false; }
+    record.exists = found > 0;
+    if(record.exists) {
+        record.passwd.assign(password, std::min<size_t>(password_len, sizeof(password)));
+    }
+    return true;
+}
+
+bool HttpRequest::user_insert(MYSQL* sql, const string& name, const string& pwd) {
+    if(!sql) { return false; }
+    SqlStmtCache* stmts = SqlConnPool::get_instance()->get_stmts(sql);
+    if(!stmts) { return false; }
+
+    MYSQL_BIND params[2];
+    unsigned long lens[2] = {name.size(), pwd.size()};
+    memset(params, 0, sizeof(params));
+    params[0].buffer_type = MYSQL_TYPE_STRING;
+    params[0].buffer = const_cast<char*>(name.data());
+    params[0].buffer_length = lens[0];
+    params[0].length = &lens[0];
+    params[1].buffer_type = MYSQL_TYPE_STRING;
+    params[1].buffer = const_cast<char*>(pwd.data());
+    params[1].buffer_length = lens[1];
+    params[1].length = &lens[1];
+    if(stmts->execute(STMT_INSERT_USER, params) < 0) {
+        LOG_DEBUG( "Insert error!");
+        return false;
     }
-    SqlConnPool::get_instance()->free_conn(sql);
     LOG_DEBUG( "User verify success!!");
-    return flag;
+    return true;
 }
 
 std::string HttpRequest::get_path() const{
@@ -280,10 +409,20 @@ std::string HttpRequest::get_path() const{
 std::string& HttpRequest::get_path(){
     return path;
 }
-std::string HttpRequest::get_method() const {
-    return method;
+
+string_view HttpRequest::get_method() const {
+    return base ? view(method) : string_view();
+}
+
+string_view HttpRequest::get_version() const {
+    return base ? view(version) : string_view();
 }
 
-std::string HttpRequest::get_version() const {
-    return version;
+string_view HttpRequest::get_header(string_view name) const {
+    for(const Field& field : fields) {
+        if(iequals(view(field.name), name)) {
+            return view(field.value);
+        }
+    }
+    return string_view();
 }
@@ -12,13 +12,18 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
-#include <regex>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <ctype.h>
 #include <errno.h>
 #include <mysql/mysql.h>
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
 #include "../pool/sql_connection_pool.h"
+#include "../pool/user_cache.h"
+#include "../pool/user_filter.h"
 
 enum PARSE_STATE {
     REQUEST_LINE,
@@ -38,6 +43,10 @@ enum HTTP_CODE {
     CLOSED_CONNECTION,
 };
 
+/* 增量解析器，直接在 Buffer 的可读区域上解析，解析完成前不消费缓冲区：
+ * 请求行、请求头、消息体只记录相对读指针的偏移，取值时返回指向缓冲区的 string_view，
+ * 数据不完整时记录扫描位置，下次从断点继续，不重复扫描。
+ * parse 返回 GET_REQUEST 后，调用方在处理完请求后 retrieve(request_size()) 并 init() */
 class HttpRequest {
 public:
 
@@ -47,28 +56,72 @@ public:
     void init();
     HTTP_CODE parse(Buffer& buff);
 
+    /* 完整请求（请求头 + 消息体）的字节数 */
+    size_t request_size() const { return parsed; }
+
     std::string get_path() const;
     std::string& get_path();
-    std::string get_method() const;
-    std::string get_version() const;
+    std::string_view get_method() const;
+    std::string_view get_version() const;
+    std::string_view get_header(std::string_view name) const;              // 不区分大小写，不存在时返回空
 
     bool is_keep_alive() const;
 
+    /* 登录/注册请求解析完成后需要查询数据库，结果由 set_verified 填回并决定跳转页面 */
+    bool need_verify() const { return verify_tag >= 0; }
+    bool is_login() const { return verify_tag == 1; }
+    std::string get_post(const std::string& key) const;
+    void set_verified(bool pass);
+
+    /* 登录先查 UserCache，未命中时由数据库线程查询，同一用户名的并发查询只执行一次；
+     * 注册在数据库线程上执行，UserFilter 判定用户名一定不存在时省去查询；启用 UserWriter 时新用户登记后批量写入。
+     * done 可能在当前线程（命中缓存）或数据库线程上被调用；执行器繁忙无法提交时返回 false，done 不会被调用 */
+    static bool verify_async(const std::string& name, const std::string& pwd, bool is_login,
+                             const std::function<void(bool pass)>& done);
+
+    /* 在数据库线程上执行 */
+    static bool user_lookup(MYSQL* sql, const std::string& name, UserRecord& record);        // 查询失败返回 false
+    static bool user_insert(MYSQL* sql, const std::string& name, const std::string& pwd);
+
 private:
-    HTTP_CODE parse_request_line(const std::string& line);
-    HTTP_CODE parse_header(const std::string& line);
+    /* 缓冲区中的一段，相对读指针的偏移 */
+    struct Slice {
+        uint32_t off;
+        uint32_t len;
+    };
+    struct Field {
+        Slice name;
+        Slice value;
+    };
+
+    std::string_view view(Slice s) const { return std::string_view(base + s.off, s.len); }
+
+    HTTP_CODE parse_request_line(size_t start, size_t len);
+    HTTP_CODE parse_header(size_t start, size_t len);
     HTTP_CODE parse_body();
     void parse_path();
-    void parse_from_url();
+    void parse_from_url(std::string_view body);
 
-    static bool user_verify(const std::string& name, const std::string& pwd, bool is_login);
+    static const char* find_lf(const char* begin, const char* end);
+    static bool iequals(std::string_view a, std::string_view b);
 
     PARSE_STATE state;
-    std::string method, path, version, body;
+    const char* base;                                   // 最近一次 parse 时缓冲区的读指针
+    size_t line_start;                                  // 当前行的起始偏移
+    size_t scan_pos;                                    // 换行符的扫描位置，数据不完整时下次从这里继续
+    size_t body_start;
+    size_t parsed;
+
+    Slice method, version;
+    std::string path;                                   // 会被改写（补全 .html、登录跳转），单独保存
+    std::vector<Field> fields;
     bool linger;
     size_t content_len;
-    std::unordered_map<std::string, std::string> header;
     std::unordered_map<std::string, std::string> post;
+    int verify_tag;                                     // 1：登录，0：注册，-1：不需要查询数据库
+
+    static const size_t MAX_HEAD_SIZE = 16384;          // 请求行 + 请求头的最大长度
+    static const size_t MAX_BODY_SIZE = 1 << 20;
 
     static const std::unordered_set<std::string> DEFAULT_HTML;
     static const std::unordered_map<std::string, int> DEFAULT_HTML_TAG;
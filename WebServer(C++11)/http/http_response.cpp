@@ -48,32 +48,27 @@ HttpResponse::HttpResponse() {
     code = -1;
     path = src_dir = "";
     is_keep_alive = false;
-    mm_file = nullptr;
-    mm_file_stat = { 0 };
 };
 
 HttpResponse::~HttpResponse() {
-    unmap_file();
+    close_file();
 }
 
 void HttpResponse::init(const string& srcDir, string& path_, bool is_keep_alive_, int code_){
     assert(srcDir != "");
-    if(mm_file) { unmap_file(); }
+    close_file();
     code = code_;
     is_keep_alive = is_keep_alive_;
     path = path_;
     src_dir = srcDir;
-    mm_file = nullptr;
-    mm_file_stat = { 0 };
 }
 
 void HttpResponse::make_response(Buffer &buff) {
-    /* 判断请求的资源文件 */
-    if(stat((src_dir + path).data(), &mm_file_stat) < 0 || S_ISDIR(mm_file_stat.st_mode)) {
-        code = 404;
-    }
-    else if(!(mm_file_stat.st_mode & S_IROTH)) {
-        code = 403;
+    /* 判断请求的资源文件，文件的打开和映射由文件缓存完成 */
+    int err = 0;
+    file_ref = FileCache::get_instance()->acquire(src_dir + path, &err);
+    if(!file_ref && code != 400) {
+        code = (err == EACCES) ? 403 : 404;
     }
     else if(code == -1) {
         code = 200;
@@ -85,17 +80,18 @@ void HttpResponse::make_response(Buffer &buff) {
 }
 
 char* HttpResponse::file() {
-    return mm_file;
+    return file_ref ? file_ref->data : nullptr;
 }
 
 size_t HttpResponse::file_len() const {
-    return mm_file_stat.st_size;
+    return file_ref ? file_ref->size : 0;
 }
 
 void HttpResponse::error_html() {
     if(CODE_PATH.count(code) == 1) {
         path = CODE_PATH.find(code)->second;
-        stat((src_dir + path).data(), &mm_file_stat);
+        int err = 0;
+        file_ref = FileCache::get_instance()->acquire(src_dir + path, &err);
     }
 }
 
@@ -119,36 +115,24 @@ void HttpResponse::add_header(Buffer &buff) {
     } else{
         buff.append("close\r\n");
     }
-    buff.append("Content-type: " + get_file_type() + "\r\n");
+    buff.append("Content-type: " + (file_ref ? file_ref->content_type : get_file_type(path)) + "\r\n");
 }
 
 void HttpResponse::add_content(Buffer& buff) {
-    int src_fd = open((src_dir + path).data(), O_RDONLY);
-    if(src_fd < 0) {
-        error_content(buff, "File Not Found!");
-        return;
-    }
-
-    /* 将文件映射到内存提高文件的访问速度 MAP_PRIVATE 建立一个写入时拷贝的私有映射*/
-    LOG_DEBUG("file path %s", (src_dir + path).data());
-    int* mm_ret = (int*)mmap(0, mm_file_stat.st_size, PROT_READ, MAP_PRIVATE, src_fd, 0);
-    if(*mm_ret == -1) {
+    if(!file_ref) {
         error_content(buff, "File Not Found!");
         return;
     }
-    mm_file = (char*)mm_ret;
-    close(src_fd);
-    buff.append("Content-length: " + to_string(mm_file_stat.st_size) + "\r\n\r\n");
+    LOG_DEBUG("file path %s", file_ref->path.data());
+    buff.append("Content-length: " + to_string(file_ref->size) + "\r\n\r\n");
 }
 
-void HttpResponse::unmap_file() {
-    if(mm_file) {
-        munmap(mm_file, mm_file_stat.st_size);
-        mm_file = nullptr;
-    }
+/* 释放响应体文件的引用，缓存条目被淘汰且没有其他引用时才会解除映射、关闭描述符 */
+void HttpResponse::close_file() {
+    file_ref.reset();
 }
 
-string HttpResponse::get_file_type() {
+string HttpResponse::get_file_type(const string& path) {
     /* 判断文件类型 */
     string::size_type idx = path.find_last_of('.');
     if(idx == string::npos) {
@@ -17,6 +17,7 @@
 
 #include "../buffer/buffer.h"
 #include "../log/log.h"
+#include "../pool/file_cache.h"
 
 class HttpResponse {
 public:
@@ -25,11 +26,15 @@ public:
 
     void init(const std::string& src_dir, std::string& path, bool is_keep_alive = false, int code = -1);
     void make_response(Buffer& buff);
-    void unmap_file();
+    void close_file();
+    FileRef take_file() { return std::move(file_ref); }
     char* file();
     size_t file_len() const;
     void error_content(Buffer& buff, std::string message);
     int get_code() const { return code; }
+    bool keep_alive() const { return is_keep_alive; }
+
+    static std::string get_file_type(const std::string& path);
 
 private:
     void add_state_line(Buffer &buff);
@@ -37,7 +42,6 @@ private:
     void add_content(Buffer &buff);
 
     void error_html();
-    std::string get_file_type();
 
     int code;
     bool is_keep_alive;
@@ -45,8 +49,7 @@ private:
     std::string path;
     std::string src_dir;
 
-    char* mm_file;
-    struct stat mm_file_stat;
+    FileRef file_ref;                                   // 响应体文件，发送期间持有缓存条目的引用
 
     static const std::unordered_map<std::string, std::string> SUFFIX_TYPE;
     static const std::unordered_map<int, std::string> CODE_STATUS;
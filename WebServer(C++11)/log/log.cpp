@@ -0,0 +1,366 @@
+/*
+ * @Description  : 异步日志
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 18:05:36
+ * @Last update  : 2026-10-18 18:05:36
+ */
+
+#include "log.h"
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <algorithm>
+using namespace std;
+
+Log::ThreadBuffer::ThreadBuffer(size_t cap_) : data(new char[cap_]), cap(cap_), head(0), tail(0), retired(false) {
+    assert(cap > 0 && (cap & (cap - 1)) == 0);
+}
+
+/* 空间不足时返回 false，不等待 */
+bool Log::ThreadBuffer::push(const char* line, size_t len) {
+    size_t t = tail.load(memory_order_relaxed);
+    if(cap - (t - head.load(memory_order_acquire)) < len) {
+        return false;
+    }
+    size_t pos = t & (cap - 1);
+    size_t first = min(len, cap - pos);
+    memcpy(data + pos, line, first);
+    memcpy(data, line + first, len - first);
+    tail.store(t + len, memory_order_release);
+    return true;
+}
+
+Log::Log() : level(1), open(false), buffer_size(0), binary(false), fd(-1), today(-1), file_index(0), file_size(0),
+        reported_dropped(0), written_formats(0), pending(false), dropped(0), is_closed(false) {}
+
+Log* Log::get_instance() {
+    static Log log;
+    return &log;
+}
+
+void Log::init(int level_, const char* path_, const char* suffix_, int que_size, bool binary_) {
+    set_level(level_);
+    if(open.load()) {
+        return;
+    }
+    path = path_;
+    suffix = suffix_;
+    binary = binary_;
+    /* 按每行约 256 字节估算，取不小于的 2 的幂 */
+    size_t bytes = static_cast<size_t>(max(que_size, 16)) * 256;
+    buffer_size = 4096;
+    while(buffer_size < bytes) { buffer_size <<= 1; }
+
+    mkdir(path.data(), 0777);
+    open_file(true);
+    is_closed = false;
+    flusher = thread(&Log::flush_thread, this);
+    open.store(fd >= 0);
+}
+
+Log::~Log() {
+    if(flusher.joinable()) {
+        {
+            lock_guard<mutex> locker(mtx);
+            is_closed = true;
+        }
+        cond.notify_one();
+        flusher.join();
+    }
+    open.store(false);
+    for(ThreadBuffer* buf : buffers) {
+        delete buf;
+    }
+    if(fd >= 0) { close(fd); }
+}
+
+/* 当前线程的暂存区，第一次写日志时创建并登记；线程退出时只做标记，由后台线程写空后回收 */
+Log::ThreadBuffer* Log::local_buffer() {
+    struct Holder {
+        ThreadBuffer* buf = nullptr;
+        ~Holder() { if(buf) { buf->retired.store(true, memory_order_release); } }
+    };
+    static thread_local Holder holder;
+    if(!holder.buf) {
+        holder.buf = new ThreadBuffer(buffer_size);
+        lock_guard<mutex> locker(buffers_mtx);
+        buffers.push_back(holder.buf);
+    }
+    return holder.buf;
+}
+
+void Log::write(int level_, const char* format, ...) {
+    static const char* const titles[] = {"[debug]: ", "[info] : ", "[warn] : ", "[error]: "};
+    char line[LINE_MAX_LEN];
+
+    /* 时间前缀每秒只格式化一次，微秒部分直接填数字 */
+    static thread_local time_t cached_sec = -1;
+    static thread_local char cached[80];
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    if(now.tv_sec != cached_sec) {
+        struct tm t;
+        localtime_r(&now.tv_sec, &t);
+        snprintf(cached, sizeof(cached), "%04d-%02d-%02d %02d:%02d:%02d.",
+                 t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec);
+        cached_sec = now.tv_sec;
+    }
+    memcpy(line, cached, 20);
+    long usec = now.tv_usec;
+    for(int i = 25; i >= 20; i--) {
+        line[i] = '0' + usec % 10;
+        usec /= 10;
+    }
+    line[26] = ' ';
+    size_t len = 27;
+    const char* title = titles[max(0, min(level_, 3))];
+    size_t title_len = strlen(title);
+    memcpy(line + len, title, title_len);
+    len += title_len;
+
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line + len, LINE_MAX_LEN - len - 1, format, args);
+    va_end(args);
+    if(n > 0) {
+        len += min(static_cast<size_t>(n), LINE_MAX_LEN - len - 2);     // 超长的行被截断
+    }
+    line[len++] = '\n';
+    push(line, len, level_);
+}
+
+void Log::push(const char* record, size_t len, int level_) {
+    ThreadBuffer* buf = local_buffer();
+    if(!buf->push(record, len)) {
+        dropped.fetch_add(1, memory_order_relaxed);
+    }
+    if(level_ >= 3 || buf->size() > buf->cap / 2) {
+        flush();
+    }
+}
+
+uint64_t Log::now_usec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t Log::register_format(int level_, const char* format) {
+    lock_guard<mutex> locker(formats_mtx);
+    formats.emplace_back(level_, format);
+    return static_cast<uint32_t>(formats.size() - 1);
+}
+
+/* 记下以 "%.*s" 输出的字符串参数，编码时按前一个整数参数截取，不要求字符串以 0 结尾 */
+LogBinary::Format::Format(int level_, const char* format_) : level(level_), format(format_), bounded(0) {
+    const char* p = format;
+    Spec spec;
+    int index = 0;
+    while(next_spec(p, spec)) {
+        if(spec.conv == '%') { continue; }
+        index += spec.stars;
+        if(spec.conv == 's' && spec.star_precision && index < 64) {
+            bounded |= 1ULL << index;
+        }
+        index++;
+    }
+    id = Log::get_instance()->register_format(level, format);
+}
+
+void Log::flush() {
+    if(!pending.exchange(true)) {
+        cond.notify_one();
+    }
+}
+
+/* 后台线程：每 100 毫秒或被唤醒时写出所有暂存区 */
+void Log::flush_thread() {
+    while(true) {
+        {
+            unique_lock<mutex> locker(mtx);
+            cond.wait_for(locker, chrono::milliseconds(100), [this] { return pending.load() || is_closed; });
+            if(is_closed) { break; }
+        }
+        pending.store(false);
+        flush_all();
+    }
+    flush_all();
+}
+
+void Log::flush_all() {
+    vector<ThreadBuffer*> list;
+    {
+        lock_guard<mutex> locker(buffers_mtx);
+        list = buffers;
+    }
+
+    /* 直接以暂存区中的数据作为 iovec，不再拷贝；每批最多 MAX_IOV 段 */
+    struct iovec iov[MAX_IOV];
+    pair<ThreadBuffer*, size_t> done[MAX_IOV];
+    int cnt = 0, done_cnt = 0;
+    size_t bytes = 0;
+    auto commit = [&]() {
+        if(cnt > 0) { write_file(iov, cnt, bytes); }
+        for(int i = 0; i < done_cnt; i++) {
+            done[i].first->head.store(done[i].second, memory_order_release);
+        }
+        cnt = done_cnt = 0;
+        bytes = 0;
+    };
+
+    for(ThreadBuffer* buf : list) {
+        size_t h = buf->head.load(memory_order_relaxed);
+        size_t t = buf->tail.load(memory_order_acquire);
+        if(h == t) { continue; }
+        if(cnt + 2 > MAX_IOV) { commit(); }
+        size_t pos = h & (buf->cap - 1);
+        size_t first = min(t - h, buf->cap - pos);
+        iov[cnt++] = {buf->data + pos, first};
+        if(first < t - h) {
+            iov[cnt++] = {buf->data, t - h - first};
+        }
+        bytes += t - h;
+        done[done_cnt++] = {buf, t};
+    }
+    commit();
+
+    /* 回收已退出线程的空暂存区 */
+    {
+        lock_guard<mutex> locker(buffers_mtx);
+        for(size_t i = 0; i < buffers.size();) {
+            ThreadBuffer* buf = buffers[i];
+            if(buf->retired.load(memory_order_acquire) && buf->size() == 0) {
+                delete buf;
+                buffers[i] = buffers.back();
+                buffers.pop_back();
+            }
+            else { i++; }
+        }
+    }
+
+    uint64_t n = dropped.load(memory_order_relaxed);
+    if(n != reported_dropped) {
+        static const char* const note_format = "log dropped %lu lines";
+        char line[64];
+        int len;
+        if(binary) {
+            static const LogBinary::Format format(2, note_format);
+            LogBinary::Encoder encoder(line, sizeof(line));
+            encoder.begin(format.id, now_usec());
+            encoder.put((unsigned long)(n - reported_dropped), format.bounded);
+            len = encoder.finish();
+        }
+        else {
+            len = snprintf(line, sizeof(line), "[warn] : log dropped %lu lines\n", (unsigned long)(n - reported_dropped));
+        }
+        struct iovec note = {line, static_cast<size_t>(len)};
+        write_file(&note, 1, len);
+        reported_dropped = n;
+    }
+}
+
+/* 写入前检查是否需要按天或按大小切分，短写时继续写剩余部分 */
+void Log::write_file(struct iovec* iov, int cnt, size_t bytes) {
+    time_t now = time(nullptr);
+    struct tm t;
+    localtime_r(&now, &t);
+    if(t.tm_yday != today) {
+        open_file(true);
+    }
+    else if(file_size > 0 && file_size + bytes > MAX_FILE_SIZE) {
+        open_file(false);
+    }
+    if(fd < 0) { return; }
+    if(binary) { write_formats(); }
+    write_all(iov, cnt);
+}
+
+/* 把上次之后新登记的格式写入当前文件，保证文件中每个编号都在第一次使用前定义 */
+void Log::write_formats() {
+    vector<pair<int, const char*>> list;
+    {
+        lock_guard<mutex> locker(formats_mtx);
+        if(written_formats == formats.size()) { return; }
+        list.assign(formats.begin() + written_formats, formats.end());
+    }
+    string records;
+    for(size_t i = 0; i < list.size(); i++) {
+        uint32_t id = static_cast<uint32_t>(written_formats + i);
+        size_t flen = min(strlen(list[i].second), static_cast<size_t>(LINE_MAX_LEN));
+        uint16_t len = static_cast<uint16_t>(LogBinary::HEADER_LEN + 5 + flen);
+        char head[LogBinary::HEADER_LEN + 5];
+        memcpy(head, &len, 2);
+        head[2] = LogBinary::FORMAT;
+        memcpy(head + 3, &id, 4);
+        head[7] = static_cast<char>(list[i].first);
+        records.append(head, sizeof(head));
+        records.append(list[i].second, flen);
+    }
+    written_formats += list.size();
+    struct iovec iov = {&records[0], records.size()};
+    write_all(&iov, 1);
+}
+
+void Log::write_all(struct iovec* iov, int cnt) {
+    while(cnt > 0) {
+        ssize_t n = writev(fd, iov, cnt);
+        if(n < 0) {
+            if(errno == EINTR) { continue; }
+            return;                                                     // 磁盘错误时丢弃本批
+        }
+        file_size += n;
+        while(cnt > 0 && static_cast<size_t>(n) >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if(cnt > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+/* 打开新文件：next_day 为 true 时按日期重新计数，否则序号加一 */
+void Log::open_file(bool next_day) {
+    time_t now = time(nullptr);
+    struct tm t;
+    localtime_r(&now, &t);
+    if(next_day) {
+        today = t.tm_yday;
+        file_index = 0;
+    }
+    else {
+        file_index++;
+    }
+
+    char name[512];
+    if(file_index == 0) {
+        snprintf(name, sizeof(name), "%s/%04d_%02d_%02d%s", path.data(),
+                 t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, suffix.data());
+    }
+    else {
+        snprintf(name, sizeof(name), "%s/%04d_%02d_%02d-%d%s", path.data(),
+                 t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, file_index, suffix.data());
+    }
+
+    int new_fd = ::open(name, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if(new_fd < 0) {
+        return;                                                         // 保留原文件继续写
+    }
+    if(fd >= 0) { close(fd); }
+    fd = new_fd;
+    struct stat st;
+    file_size = fstat(fd, &st) == 0 ? st.st_size : 0;
+
+    /* 新文件重新写入全部格式；追加到已有文件时新的格式记录会覆盖同编号的旧定义 */
+    written_formats = 0;
+    if(binary && file_size == 0) {
+        struct iovec iov = {const_cast<char*>(LogBinary::MAGIC), sizeof(LogBinary::MAGIC)};
+        write_all(&iov, 1);
+    }
+}
@@ -0,0 +1,163 @@
+/*
+ * @Description  : 异步日志
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 18:05:36
+ * @Last update  : 2026-10-18 18:05:36
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <assert.h>
+#include <sys/uio.h>
+#include "log_binary.h"
+
+/* 编译期最低日志级别，低于该级别的 LOG_xxx 不会被执行，参数也不会被求值（make LOG_MIN_LEVEL=1） */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+/* 每个写日志的线程有自己的暂存区（单生产者单消费者的字节环形队列），写日志时只格式化并拷贝到暂存区，
+ * 不加锁、不做磁盘 I/O；后台线程定期或在暂存区过半时被唤醒，把所有暂存区的内容用一次 writev 写入文件。
+ * 暂存区满时丢弃该行并计数，写日志的线程永远不会因为磁盘阻塞。
+ * 日志文件按天切分，单个文件超过 MAX_FILE_SIZE 时切分为 日期-序号 的新文件。
+ * 二进制模式下调用点只写入格式编号和原始参数，不做格式化，由 tools/log_decoder 离线还原为文本 */
+class Log {
+public:
+    static Log* get_instance();
+
+    /* level：运行期最低级别；path：日志目录；suffix：文件后缀；que_size：每个线程暂存区大约可容纳的行数 */
+    void init(int level, const char* path = "./log", const char* suffix = ".log", int que_size = 1024, bool binary = false);
+
+    void write(int level, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+    template<typename... Args>
+    void write_binary(const LogBinary::Format& format, const Args&... args) {
+        char record[LINE_MAX_LEN];
+        LogBinary::Encoder encoder(record, sizeof(record));
+        encoder.begin(format.id, now_usec());
+        (encoder.put(args, format.bounded), ...);
+        push(record, encoder.finish(), format.level);
+    }
+
+    /* 登记调用点的格式字符串，返回格式编号 */
+    uint32_t register_format(int level, const char* format);
+    void flush();                                                       // 唤醒后台线程立即写入，不等待
+
+    int get_level() const { return level.load(std::memory_order_relaxed); }
+    void set_level(int level_) { level.store(level_, std::memory_order_relaxed); }
+    bool is_open() const { return open.load(std::memory_order_relaxed); }
+    bool is_binary() const { return binary; }
+    uint64_t dropped_count() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    Log();
+    ~Log();
+
+    /* 线程暂存区，生产者为所属线程，消费者为后台线程 */
+    struct ThreadBuffer {
+        explicit ThreadBuffer(size_t cap_);
+        ~ThreadBuffer() { delete[] data; }
+
+        bool push(const char* line, size_t len);
+        size_t size() const { return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed); }
+
+        char* data;
+        size_t cap;                                                     // 2 的幂
+        alignas(64) std::atomic<size_t> head;                           // 后台线程已写出的位置
+        alignas(64) std::atomic<size_t> tail;                           // 所属线程已写入的位置
+        std::atomic<bool> retired;                                      // 所属线程已退出，写空后回收
+    };
+
+    ThreadBuffer* local_buffer();
+    void push(const char* record, size_t len, int level);
+    static uint64_t now_usec();
+    void flush_thread();
+    void flush_all();
+    void write_file(struct iovec* iov, int cnt, size_t bytes);
+    void write_all(struct iovec* iov, int cnt);
+    void write_formats();
+    void open_file(bool next_day);
+
+    static const int LINE_MAX_LEN = 2048;
+    static const size_t MAX_FILE_SIZE = 64 << 20;
+    static const int MAX_IOV = 64;
+
+    std::atomic<int> level;
+    std::atomic<bool> open;
+    std::string path;
+    std::string suffix;
+    size_t buffer_size;                                                 // 每个线程暂存区的字节数
+    bool binary;                                                        // 二进制模式
+
+    /* 以下只由后台线程访问 */
+    int fd;
+    int today;                                                          // 当前文件对应的日期（tm_yday）
+    int file_index;                                                     // 当天按大小切分的序号
+    size_t file_size;
+    uint64_t reported_dropped;
+    size_t written_formats;                                             // 当前文件已写入的格式记录数
+
+    std::mutex formats_mtx;                                             // 保护格式表
+    std::vector<std::pair<int, const char*>> formats;                   // 下标为格式编号
+
+    std::mutex buffers_mtx;                                             // 保护暂存区列表
+    std::vector<ThreadBuffer*> buffers;
+
+    std::mutex mtx;                                                     // 后台线程等待用
+    std::condition_variable cond;
+    std::atomic<bool> pending;                                          // 已请求立即写入
+    std::atomic<uint64_t> dropped;                                      // 暂存区满被丢弃的行数
+    bool is_closed;
+    std::thread flusher;
+};
+
+/* 二进制模式下每个调用点用一个静态的格式对象，第一次执行时登记编号；文本模式的分支同时保留了格式检查 */
+#define LOG_BASE(level, format, ...) \
+    do { \
+        Log* log = Log::get_instance(); \
+        if(log->is_open() && log->get_level() <= level) { \
+            if(log->is_binary()) { \
+                static const LogBinary::Format log_format(level, format); \
+                log->write_binary(log_format, ##__VA_ARGS__); \
+            } \
+            else { log->write(level, format, ##__VA_ARGS__); } \
+        } \
+    } while(0)
+
+/* 编译期关闭的级别保留格式检查，但条件恒假，整条语句被编译器消除 */
+#define LOG_NONE(level, format, ...) \
+    do { if(false) { Log::get_instance()->write(level, format, ##__VA_ARGS__); } } while(0)
+
+#if LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(format, ...) LOG_BASE(0, format, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(format, ...) LOG_NONE(0, format, ##__VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= 1
+#define LOG_INFO(format, ...) LOG_BASE(1, format, ##__VA_ARGS__)
+#else
+#define LOG_INFO(format, ...) LOG_NONE(1, format, ##__VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= 2
+#define LOG_WARN(format, ...) LOG_BASE(2, format, ##__VA_ARGS__)
+#else
+#define LOG_WARN(format, ...) LOG_NONE(2, format, ##__VA_ARGS__)
+#endif
+
+#define LOG_ERROR(format, ...) LOG_BASE(3, format, ##__VA_ARGS__)
+
+
+#endif //LOG_H
@@ -0,0 +1,163 @@
+/*
+ * @Description  : 二进制日志记录格式
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 20:12:40
+ * @Last update  : 2026-10-18 20:12:40
+ */
+
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+
+#include <string>
+#include <algorithm>
+#include <type_traits>
+#include <string.h>
+#include <stdint.h>
+
+/* 二进制日志文件以 MAGIC 开头，之后是连续的记录，所有整数按本机字节序：
+ *   记录头    : uint16 总长度 | uint8 类型
+ *   FORMAT    : uint32 格式编号 | uint8 级别 | 格式字符串（不含结尾 0）
+ *   EVENT     : uint32 格式编号 | uint64 时间戳（微秒） | 参数...
+ *   参数      : uint8 类型标记 | 数据（ARG_INT/ARG_UINT/ARG_PTR 8 字节，ARG_DOUBLE 8 字节，ARG_STR uint16 长度 + 内容）
+ * 每个文件在使用某个格式编号之前都会先写入对应的 FORMAT 记录，文件可以单独解码 */
+namespace LogBinary {
+
+static const char MAGIC[8] = {'W', 'S', 'B', 'L', 'O', 'G', '0', '1'};
+
+enum RecordType : uint8_t { FORMAT = 1, EVENT = 2 };
+enum ArgTag : uint8_t { ARG_INT = 'i', ARG_UINT = 'u', ARG_DOUBLE = 'f', ARG_STR = 's', ARG_PTR = 'p' };
+
+static const size_t HEADER_LEN = 3;
+static const size_t EVENT_HEADER_LEN = HEADER_LEN + 4 + 8;
+
+/* printf 格式中的一个转换说明 */
+struct Spec {
+    const char* begin;                                                  // 指向 '%'
+    const char* end;                                                    // 指向转换字符之后
+    int stars;                                                          // 宽度和精度中 '*' 的个数，各占用一个参数
+    bool star_precision;                                                // 精度为 '*'
+    char conv;                                                          // 转换字符，'%%' 时为 '%'
+};
+
+/* 从 p 开始找下一个转换说明，没有时返回 false */
+inline bool next_spec(const char*& p, Spec& spec) {
+    while(*p && *p != '%') { p++; }
+    if(!*p) { return false; }
+    spec.begin = p++;
+    spec.stars = 0;
+    spec.star_precision = false;
+    while(*p && strchr("-+ #0'", *p)) { p++; }
+    if(*p == '*') { spec.stars++; p++; }
+    while(*p >= '0' && *p <= '9') { p++; }
+    if(*p == '.') {
+        p++;
+        if(*p == '*') { spec.stars++; spec.star_precision = true; p++; }
+        while(*p >= '0' && *p <= '9') { p++; }
+    }
+    while(*p && strchr("hlLqjzt", *p)) { p++; }
+    spec.conv = *p;
+    if(*p) { p++; }
+    spec.end = p;
+    return true;
+}
+
+/* 调用点的格式信息，第一次执行到该调用点时登记并得到编号 */
+struct Format {
+    Format(int level_, const char* format_);
+
+    uint32_t id;
+    int level;
+    const char* format;
+    uint64_t bounded;                                                   // 第 i 位为 1：第 i 个参数是以 "%.*s" 输出的字符串，长度由前一个参数给出
+};
+
+/* 把一条 EVENT 记录编码到调用方的缓冲区，超出容量的参数被丢弃 */
+class Encoder {
+public:
+    Encoder(char* buf_, size_t cap_) : buf(buf_), cap(cap_), len(EVENT_HEADER_LEN), index(0), last_int(-1) {}
+
+    void begin(uint32_t id, uint64_t usec) {
+        buf[2] = EVENT;
+        memcpy(buf + HEADER_LEN, &id, 4);
+        memcpy(buf + HEADER_LEN + 4, &usec, 8);
+    }
+
+    size_t finish() {
+        uint16_t n = static_cast<uint16_t>(len);
+        memcpy(buf, &n, 2);
+        return len;
+    }
+
+    template<typename T>
+    void put(const T& value, uint64_t bounded) {
+        put_arg(value, (bounded >> index) & 1);
+        index++;
+    }
+
+private:
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+    put_arg(T value, bool) {
+        if(std::is_signed<T>::value || std::is_enum<T>::value) {
+            int64_t v = static_cast<int64_t>(value);
+            last_int = v;
+            put_raw(ARG_INT, &v, 8);
+        }
+        else {
+            uint64_t v = static_cast<uint64_t>(value);
+            last_int = static_cast<int64_t>(v);
+            put_raw(ARG_UINT, &v, 8);
+        }
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type
+    put_arg(T value, bool) {
+        double v = value;
+        put_raw(ARG_DOUBLE, &v, 8);
+    }
+
+    void put_arg(const char* s, bool bounded) {
+        if(!s) { s = "(null)"; bounded = false; }
+        size_t n = bounded ? strnlen(s, last_int > 0 ? static_cast<size_t>(last_int) : 0) : strlen(s);
+        put_str(s, n);
+    }
+
+    void put_arg(char* s, bool bounded) { put_arg(static_cast<const char*>(s), bounded); }
+    void put_arg(const std::string& s, bool) { put_str(s.data(), s.size()); }
+
+    template<typename T>
+    void put_arg(T* p, bool) {
+        uint64_t v = reinterpret_cast<uintptr_t>(p);
+        put_raw(ARG_PTR, &v, 8);
+    }
+
+    void put_raw(uint8_t tag, const void* data, size_t n) {
+        if(len + 1 + n > cap) { return; }
+        buf[len++] = tag;
+        memcpy(buf + len, data, n);
+        len += n;
+    }
+
+    void put_str(const char* s, size_t n) {
+        if(len + 3 > cap) { return; }
+        n = std::min(n, cap - len - 3);                                 // 超长的字符串被截断
+        uint16_t n16 = static_cast<uint16_t>(n);
+        buf[len++] = ARG_STR;
+        memcpy(buf + len, &n16, 2);
+        memcpy(buf + len + 2, s, n);
+        len += 2 + n;
+    }
+
+    char* buf;
+    size_t cap;
+    size_t len;
+    int index;
+    int64_t last_int;                                                   // 最近一个整数参数，作为 "%.*s" 的长度
+};
+
+}
+
+
+#endif
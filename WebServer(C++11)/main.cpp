@@ -12,10 +12,23 @@ int TIME_OUT = 60000;                   // 超时时间（毫秒）
 bool OPT_LINGER = false;                // 优雅关闭链接
 int THREAD_NUM = 8;                     // 线程池内的线程数量
 int SQL_NUM = 12;                       // 数据库连接池数量
+int REACTOR_NUM = 0;                    // 子 Reactor 数量（0：单 Reactor + 线程池）
+int DISPATCH_MODE = 0;                  // 新连接分配方式
+int LISTEN_SHARDS = 0;                  // SO_REUSEPORT 监听分片数（0：单个监听套接字，需 REACTOR_NUM > 0）
+int LISTEN_BACKLOG = 1024;              // 监听队列长度
+int IO_ENGINE = 0;                      // I/O 引擎
+int SENDFILE_THRESHOLD = 65536;         // 不小于该大小（字节）的文件用 sendfile 发送（0：全部使用 mmap）
+int FILE_CACHE_SIZE = 64;               // 静态文件缓存上限（MB，0：不缓存）
+int BUFFER_HIGH_WATER = 0;              // 连接缓冲区取空时保留的最大容量（字节，0：取空即归还内存池）
+int CPU_AFFINITY = 0;                   // 线程绑核（0：不绑定，1：主循环、子 Reactor、工作线程依次绑定到各个 CPU）
+int USER_WRITE_MODE = 0;                // 注册写入方式
+int USER_WRITE_FLUSH_MS = 10;           // 批量写入时一批最长等待时间（毫秒）
+int USER_WRITE_BATCH = 256;             // 批量写入时每个事务最多的行数
 
 bool OPEN_LOG = false;                   // 是否开启日志
 int LOG_LEVEL = 1;                      // 日志级别
 int LOG_QUE_SIZE = 1024;                // 日志队列大小
+bool LOG_BINARY = false;                // 二进制日志（用 tools/log_decoder 还原为文本）
 
 int SERVER_PORT = 9006;                 // 端口号
 int SQL_PORT = 3306;                    // 数据库端口
@@ -32,6 +45,16 @@ int main(int argc, char *argv[]) {
         1：连接ET，监听LT
         2：连接LT，监听ET
         3：连接和监听都是ET
+    I/O 引擎
+        0：epoll
+        1：io_uring（不可用时回退到 epoll；内核 6.1+ 时 accept 由 multishot 完成，REACTOR_NUM > 0 时连接的 recv/send 也由 io_uring 完成）
+    注册写入方式
+        0：每个注册单独 INSERT，写入后响应
+        1：批量 INSERT，写入后响应
+        2：登记后立即响应，之后批量写入（进程崩溃会丢失最近一批注册）
+    新连接分配方式（REACTOR_NUM > 0 时有效）
+        0：轮询
+        1：最小连接数
     日志等级
         0：DEBUG
         1：INFO
@@ -42,7 +65,10 @@ int main(int argc, char *argv[]) {
     WebServer server(
         SERVER_PORT, TRIG_MODE, TIME_OUT, OPT_LINGER,
         SQL_PORT, SQL_USER, SQL_PWD, SQL_NAME, SQL_NUM,
-        THREAD_NUM, OPEN_LOG, LOG_LEVEL, LOG_QUE_SIZE);
+        THREAD_NUM, REACTOR_NUM, DISPATCH_MODE, LISTEN_SHARDS, LISTEN_BACKLOG,
+        IO_ENGINE, SENDFILE_THRESHOLD, FILE_CACHE_SIZE, BUFFER_HIGH_WATER, CPU_AFFINITY,
+        USER_WRITE_MODE, USER_WRITE_FLUSH_MS, USER_WRITE_BATCH,
+        OPEN_LOG, LOG_LEVEL, LOG_QUE_SIZE, LOG_BINARY);
 
     server.start();
 
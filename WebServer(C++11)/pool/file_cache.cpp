@@ -0,0 +1,149 @@
+/*
+ * @Description  : 静态文件缓存
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-17 14:02:31
+ * @Last update  : 2026-10-17 14:02:31
+ */
+
+#include "file_cache.h"
+using namespace std;
+
+FileEntry::~FileEntry() {
+    if(data) { munmap(data, size); }
+    if(fd >= 0) { close(fd); }
+}
+
+FileCache::FileCache() : max_bytes(0), mmap_limit(0), type_of(nullptr), revalidate(1000),
+        total_bytes(0), hits(0), misses(0), evictions(0) {}
+
+/* 获取文件缓存的唯一实例 */
+FileCache* FileCache::get_instance() {
+    static FileCache cache;
+    return &cache;
+}
+
+void FileCache::init(size_t max_bytes_, size_t mmap_limit_, TypeResolver type_of_, int revalidate_ms) {
+    assert(type_of_);
+    lock_guard<mutex> locker(mtx);
+    max_bytes = max_bytes_;
+    mmap_limit = mmap_limit_;
+    type_of = type_of_;
+    revalidate = chrono::milliseconds(revalidate_ms);
+}
+
+/* 命中时最多每 revalidate 毫秒 stat 一次，文件大小或修改时间变化则重新加载 */
+FileRef FileCache::acquire(const string& path, int* err) {
+    auto now = chrono::steady_clock::now();
+    if(max_bytes > 0) {
+        lock_guard<mutex> locker(mtx);
+        auto it = entries.find(path);
+        if(it != entries.end()) {
+            shared_ptr<FileEntry> entry = *it->second;
+            bool fresh = now - entry->checked < revalidate;
+            if(!fresh) {
+                struct stat st;
+                fresh = stat(path.data(), &st) == 0 && st.st_mtime == entry->mtime &&
+                        static_cast<size_t>(st.st_size) == entry->size;
+                entry->checked = now;
+            }
+            if(fresh) {
+                lru.splice(lru.begin(), lru, it->second);
+                hits++;
+                return entry;
+            }
+            erase(path);
+        }
+    }
+
+    misses++;
+    shared_ptr<FileEntry> entry = load(path, err);
+    if(entry && max_bytes > 0) {
+        insert(entry);
+    }
+    return entry;
+}
+
+/* 打开并映射文件，在锁外执行 */
+shared_ptr<FileEntry> FileCache::load(const string& path, int* err) {
+    struct stat st;
+    if(stat(path.data(), &st) < 0 || S_ISDIR(st.st_mode)) {
+        *err = ENOENT;
+        return nullptr;
+    }
+    if(!(st.st_mode & S_IROTH)) {
+        *err = EACCES;
+        return nullptr;
+    }
+
+    shared_ptr<FileEntry> entry = make_shared<FileEntry>();
+    entry->fd = open(path.data(), O_RDONLY | O_CLOEXEC);
+    if(entry->fd < 0) {
+        *err = ENOENT;
+        return nullptr;
+    }
+    entry->path = path;
+    entry->size = st.st_size;
+    entry->mtime = st.st_mtime;
+    entry->content_type = type_of(path);
+    entry->checked = chrono::steady_clock::now();
+
+    /* 映射失败时保留描述符，由 sendfile 发送 */
+    if(entry->size > 0 && (mmap_limit == 0 || entry->size < mmap_limit)) {
+        void* ret = mmap(0, entry->size, PROT_READ, MAP_PRIVATE, entry->fd, 0);
+        if(ret != MAP_FAILED) {
+            entry->data = static_cast<char*>(ret);
+        }
+    }
+    LOG_DEBUG("FileCache load %s, size:%zu", path.data(), entry->size);
+    return entry;
+}
+
+void FileCache::insert(const shared_ptr<FileEntry>& entry) {
+    size_t bytes = entry->data ? entry->size : 0;
+    if(bytes > max_bytes) {
+        return;                                         // 超过缓存上限的文件只供本次请求使用
+    }
+    lock_guard<mutex> locker(mtx);
+    /* 其他线程可能已经加载了同一文件，以新加载的为准 */
+    if(entries.count(entry->path)) {
+        erase(entry->path);
+    }
+    lru.push_front(entry);
+    entries[entry->path] = lru.begin();
+    total_bytes += bytes;
+
+    while(!lru.empty() && (total_bytes > max_bytes || entries.size() > MAX_ENTRIES)) {
+        erase(lru.back()->path);
+        evictions++;
+    }
+}
+
+/* 从缓存中移除，需持有 mtx；条目在最后一个引用释放时才关闭 */
+void FileCache::erase(const string& path) {
+    auto it = entries.find(path);
+    if(it == entries.end()) {
+        return;
+    }
+    const shared_ptr<FileEntry>& entry = *it->second;
+    total_bytes -= entry->data ? entry->size : 0;
+    lru.erase(it->second);
+    entries.erase(it);
+}
+
+void FileCache::clear() {
+    lock_guard<mutex> locker(mtx);
+    entries.clear();
+    lru.clear();
+    total_bytes = 0;
+}
+
+void FileCache::log_stats() {
+    size_t cached = 0, bytes = 0;
+    {
+        lock_guard<mutex> locker(mtx);
+        cached = entries.size();
+        bytes = total_bytes;
+    }
+    LOG_INFO("FileCache entries:%zu, bytes:%zu, hits:%lu, misses:%lu, evictions:%lu", cached, bytes,
+             (unsigned long)hits, (unsigned long)misses, (unsigned long)evictions);
+}
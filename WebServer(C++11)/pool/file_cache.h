@@ -0,0 +1,90 @@
+/*
+ * @Description  : 静态文件缓存
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-17 14:02:31
+ * @Last update  : 2026-10-17 14:02:31
+ */
+
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "../log/log.h"
+
+/* 缓存的文件：描述符保持打开（sendfile 使用），小文件同时建立只读映射 */
+struct FileEntry {
+    FileEntry() : fd(-1), data(nullptr), size(0), mtime(0) {}
+    ~FileEntry();
+    FileEntry(const FileEntry&) = delete;
+    FileEntry& operator=(const FileEntry&) = delete;
+
+    std::string path;
+    int fd;
+    char* data;                                         // 文件映射，大文件为 nullptr
+    size_t size;
+    time_t mtime;
+    std::string content_type;
+    std::chrono::steady_clock::time_point checked;      // 上次 stat 校验的时间
+};
+
+typedef std::shared_ptr<const FileEntry> FileRef;
+
+/* 进程内共享的静态文件缓存，以完整路径为键，LRU 淘汰，映射总字节数有上限；
+ * 条目由 shared_ptr 引用计数，被淘汰后仍由发送中的响应持有，最后一个引用释放时才解除映射 */
+class FileCache {
+public:
+    typedef std::string (*TypeResolver)(const std::string& path);
+
+    static FileCache* get_instance();
+
+    /* max_bytes 为 0 时不缓存，每次请求都重新打开文件；不小于 mmap_limit 的文件不做映射（0 表示全部映射） */
+    void init(size_t max_bytes, size_t mmap_limit, TypeResolver type_of, int revalidate_ms = 1000);
+
+    /* 失败返回 nullptr，err 为 ENOENT（不存在或为目录）或 EACCES（无读权限） */
+    FileRef acquire(const std::string& path, int* err);
+
+    void clear();
+    void log_stats();
+
+private:
+    FileCache();
+    ~FileCache() = default;
+
+    std::shared_ptr<FileEntry> load(const std::string& path, int* err);
+    void insert(const std::shared_ptr<FileEntry>& entry);
+    void erase(const std::string& path);
+
+    typedef std::list<std::shared_ptr<FileEntry>> LruList;
+
+    size_t max_bytes;
+    size_t mmap_limit;
+    TypeResolver type_of;
+    std::chrono::milliseconds revalidate;
+
+    std::mutex mtx;
+    LruList lru;                                        // 表头为最近使用
+    std::unordered_map<std::string, LruList::iterator> entries;
+    size_t total_bytes;                                 // 已缓存的映射字节数
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> evictions;
+
+    static const size_t MAX_ENTRIES = 1024;             // 缓存条目上限，限制常驻的文件描述符数量
+};
+
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * @Description  : 有界无锁多生产者多消费者队列
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 15:20:44
+ * @Last update  : 2026-10-18 15:20:44
+ */
+
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <assert.h>
+
+/* 基于序号的环形队列（Vyukov）：每个槽带一个序号，生产者和消费者各自用 CAS 推进位置，
+ * 槽的序号表示它当前可写还是可读，入队出队都不加锁。容量为 2 的幂，满时 push 返回 false */
+template<typename T>
+class MpmcQueue {
+public:
+    explicit MpmcQueue(size_t capacity = 1024) : cells(capacity), mask(capacity - 1), enqueue_pos(0), dequeue_pos(0) {
+        assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+        for(size_t i = 0; i < capacity; i++) {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    bool push(const T& data) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if(diff == 0) {
+                if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if(diff < 0) {
+                return false;                                               // 队列已满
+            }
+            else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = data;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& data) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while(true) {
+            cell = &cells[pos & mask];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if(diff == 0) {
+                if(dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if(diff < 0) {
+                return false;                                               // 队列为空
+            }
+            else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        data = cell->data;
+        cell->seq.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* 近似长度，只用于负载选择和统计 */
+    size_t size() const {
+        size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+        size_t head = dequeue_pos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    std::vector<Cell> cells;
+    const size_t mask;
+    alignas(64) std::atomic<size_t> enqueue_pos;                            // 生产者和消费者的位置放在不同的缓存行
+    alignas(64) std::atomic<size_t> dequeue_pos;
+};
+
+
+#endif
@@ -30,10 +30,15 @@ void SqlConnPool::init(const char* host, int port, const char* user,const char*
             LOG_ERROR("MySql init error!");
             assert(sql);
         }
+        bool reconnect = true;                                      // 断线后自动重连，语句缓存据此重新准备
+        mysql_options(sql, MYSQL_OPT_RECONNECT, &reconnect);
         sql = mysql_real_connect(sql, host, user, pwd, db_name, port, nullptr, 0);
         if (!sql) {
             LOG_ERROR("MySql Connect error!");
         }
+        else {
+            stmt_caches[sql].reset(new SqlStmtCache(sql));
+        }
         conn_que.push(sql);
     }
     MAX_CONN = conn_size;
@@ -64,9 +69,15 @@ void SqlConnPool::free_conn(MYSQL* sql) {
     sem_post(&sem);
 }
 
+SqlStmtCache* SqlConnPool::get_stmts(MYSQL* sql) {
+    auto it = stmt_caches.find(sql);
+    return it == stmt_caches.end() ? nullptr : it->second.get();
+}
+
 /* 关闭数据库连接池 */
 void SqlConnPool::close_pool() {
     lock_guard<mutex> locker(mtx);
+    stmt_caches.clear();                                            // 语句要在连接关闭之前释放
     while(!conn_que.empty()) {
         auto sql = conn_que.front();
         conn_que.pop();
@@ -14,7 +14,10 @@
 #include <mutex>
 #include <semaphore.h>
 #include <thread>
+#include <memory>
+#include <unordered_map>
 #include "../log/log.h"
+#include "sql_stmt_cache.h"
 
 class SqlConnPool {
 public:
@@ -24,6 +27,9 @@ public:
     void free_conn(MYSQL* conn);
     int get_free_conn_count();
 
+    /* 连接对应的预处理语句缓存，只能由持有该连接的线程使用 */
+    SqlStmtCache* get_stmts(MYSQL* conn);
+
     void init(const char* host, int port,
               const char* user,const char* pwd,
               const char* db_name, int conn_size);
@@ -38,6 +44,7 @@ private:
     int free_count;
 
     std::queue<MYSQL*> conn_que;
+    std::unordered_map<MYSQL*, std::unique_ptr<SqlStmtCache>> stmt_caches;    // init 之后只读
     std::mutex mtx;
     sem_t sem;
 };
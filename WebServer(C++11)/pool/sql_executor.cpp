@@ -0,0 +1,79 @@
+/*
+ * @Description  : 异步数据库执行器
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 21:30:12
+ * @Last update  : 2026-10-18 21:30:12
+ */
+
+#include "sql_executor.h"
+using namespace std;
+
+SqlExecutor* SqlExecutor::get_instance() {
+    static SqlExecutor executor;
+    return &executor;
+}
+
+void SqlExecutor::init(int thread_num, size_t max_jobs_) {
+    assert(thread_num > 0);
+    {
+        lock_guard<mutex> locker(mtx);
+        if(!is_closed) { return; }
+        is_closed = false;
+        max_jobs = max_jobs_;
+    }
+    for(int i = 0; i < thread_num; i++) {
+        threads.emplace_back(&SqlExecutor::run, this);
+    }
+}
+
+void SqlExecutor::stop() {
+    {
+        lock_guard<mutex> locker(mtx);
+        if(is_closed) { return; }
+        is_closed = true;
+        queue<Job>().swap(jobs);
+    }
+    cond.notify_all();
+    for(thread& t : threads) {
+        t.join();
+    }
+    threads.clear();
+}
+
+bool SqlExecutor::submit(Job job) {
+    {
+        lock_guard<mutex> locker(mtx);
+        if(is_closed || jobs.size() >= max_jobs) {
+            return false;
+        }
+        jobs.push(std::move(job));
+    }
+    cond.notify_one();
+    return true;
+}
+
+size_t SqlExecutor::pending() {
+    lock_guard<mutex> locker(mtx);
+    return jobs.size();
+}
+
+void SqlExecutor::run() {
+    MYSQL* sql = SqlConnPool::get_instance()->get_conn();
+    if(!sql) {
+        LOG_WARN("SqlExecutor thread has no connection!");
+    }
+    unique_lock<mutex> locker(mtx);
+    while(true) {
+        cond.wait(locker, [this] { return is_closed || !jobs.empty(); });
+        if(is_closed) { break; }
+        Job job = std::move(jobs.front());
+        jobs.pop();
+        locker.unlock();
+        job(sql);
+        locker.lock();
+    }
+    locker.unlock();
+    if(sql) {
+        SqlConnPool::get_instance()->free_conn(sql);
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * @Description  : 异步数据库执行器
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 21:30:12
+ * @Last update  : 2026-10-18 21:30:12
+ */
+
+#ifndef SQL_EXECUTOR_H
+#define SQL_EXECUTOR_H
+
+
+#include <mysql/mysql.h>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <thread>
+#include <vector>
+#include <functional>
+
+#include "sql_connection_pool.h"
+
+/* 专用的数据库线程，每个线程从 SqlConnPool 取一个连接独占使用。
+ * 工作线程和 Reactor 线程只提交任务，不等待数据库往返；任务在数据库线程上执行，
+ * 结果由任务自己投递回连接所属的事件循环 */
+class SqlExecutor {
+public:
+    typedef std::function<void(MYSQL*)> Job;                            // 连接不可用时参数为 nullptr
+
+    static SqlExecutor* get_instance();
+
+    void init(int thread_num, size_t max_jobs = 4096);
+    void stop();                                                        // 等待正在执行的任务结束，丢弃未执行的任务
+
+    /* 执行器未启动或排队已满时返回 false，由调用方直接按失败处理 */
+    bool submit(Job job);
+
+    size_t pending();
+
+private:
+    SqlExecutor() : max_jobs(0), is_closed(true) {}
+    ~SqlExecutor() { stop(); }
+
+    void run();
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::queue<Job> jobs;
+    size_t max_jobs;
+    bool is_closed;
+    std::vector<std::thread> threads;
+};
+
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * @Description  : 数据库连接的预处理语句缓存
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 22:10:26
+ * @Last update  : 2026-10-18 22:10:26
+ */
+
+#include "sql_stmt_cache.h"
+#include <string.h>
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+using namespace std;
+
+const char* const SqlStmtCache::QUERIES[STMT_NUM] = {
+    "SELECT passwd FROM user WHERE username = ? LIMIT 1",
+    "INSERT INTO user(username, passwd) VALUES(?, ?)",
+};
+
+SqlStmtCache::SqlStmtCache(MYSQL* sql_) : sql(sql_), thread_id(0) {
+    memset(stmts, 0, sizeof(stmts));
+}
+
+SqlStmtCache::~SqlStmtCache() {
+    reset();
+}
+
+void SqlStmtCache::reset() {
+    for(MYSQL_STMT*& stmt : stmts) {
+        if(stmt) {
+            mysql_stmt_close(stmt);
+            stmt = nullptr;
+        }
+    }
+}
+
+bool SqlStmtCache::is_conn_error(unsigned int err) {
+    return err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST ||
+           err == ER_UNKNOWN_STMT_HANDLER || err == ER_NEED_REPREPARE;
+}
+
+/* 取已准备的语句，连接重连过（线程号变化）时先丢弃旧的句柄 */
+MYSQL_STMT* SqlStmtCache::prepare(SQL_STMT id) {
+    unsigned long tid = mysql_thread_id(sql);
+    if(tid != thread_id) {
+        reset();
+        thread_id = tid;
+    }
+    if(stmts[id]) {
+        return stmts[id];
+    }
+    MYSQL_STMT* stmt = mysql_stmt_init(sql);
+    if(!stmt) {
+        LOG_ERROR("MySql stmt init error!");
+        return nullptr;
+    }
+    if(mysql_stmt_prepare(stmt, QUERIES[id], strlen(QUERIES[id]))) {
+        LOG_ERROR("MySql prepare error:%s", mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    stmts[id] = stmt;
+    return stmt;
+}
+
+/* 连接已断开时 mysql_ping 会按 MYSQL_OPT_RECONNECT 重连，之后所有语句重新准备 */
+bool SqlStmtCache::reconnect() {
+    reset();
+    thread_id = 0;
+    return mysql_ping(sql) == 0;
+}
+
+int SqlStmtCache::execute(SQL_STMT id, MYSQL_BIND* params, MYSQL_BIND* results, bool retry) {
+    for(int attempt = retry ? 0 : 1; attempt < 2; attempt++) {
+        MYSQL_STMT* stmt = prepare(id);
+        if(!stmt) {
+            if(attempt == 0 && is_conn_error(mysql_errno(sql)) && reconnect()) { continue; }
+            return -1;
+        }
+        if(mysql_stmt_bind_param(stmt, params) || mysql_stmt_execute(stmt)) {
+            if(attempt == 0 && is_conn_error(mysql_stmt_errno(stmt)) && reconnect()) { continue; }
+            LOG_ERROR("MySql execute error:%s", mysql_stmt_error(stmt));
+            return -1;
+        }
+        if(!results) {
+            return static_cast<int>(mysql_stmt_affected_rows(stmt));
+        }
+        if(mysql_stmt_bind_result(stmt, results) || mysql_stmt_store_result(stmt)) {
+            LOG_ERROR("MySql store result error:%s", mysql_stmt_error(stmt));
+            mysql_stmt_free_result(stmt);
+            return -1;
+        }
+        /* 取结果出错不能当作没有这一行，否则调用方会把用户当作不存在缓存下来 */
+        int ret = mysql_stmt_fetch(stmt);
+        if(ret != 0 && ret != MYSQL_DATA_TRUNCATED && ret != MYSQL_NO_DATA) {
+            LOG_ERROR("MySql fetch error:%s", mysql_stmt_error(stmt));
+        }
+        mysql_stmt_free_result(stmt);
+        if(ret == 0 || ret == MYSQL_DATA_TRUNCATED) { return 1; }
+        return ret == MYSQL_NO_DATA ? 0 : -1;
+    }
+    return -1;
+}
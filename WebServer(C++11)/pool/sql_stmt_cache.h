@@ -0,0 +1,54 @@
+/*
+ * @Description  : 数据库连接的预处理语句缓存
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 22:10:26
+ * @Last update  : 2026-10-18 22:10:26
+ */
+
+#ifndef SQL_STMT_CACHE_H
+#define SQL_STMT_CACHE_H
+
+
+#include <mysql/mysql.h>
+#include "../log/log.h"
+
+/* 服务器使用的固定语句集合 */
+enum SQL_STMT {
+    STMT_SELECT_USER = 0,                               // 按用户名查询密码
+    STMT_INSERT_USER,                                   // 注册新用户
+    STMT_NUM,
+};
+
+/* 每个连接池中的连接各有一个缓存，语句在第一次使用时准备，之后只发送参数（二进制协议）。
+ * 连接断开重连后服务端的语句句柄全部失效，检测到连接线程号变化或连接错误时丢弃并重新准备。
+ * 同一时刻只由持有该连接的线程使用，不加锁 */
+class SqlStmtCache {
+public:
+    explicit SqlStmtCache(MYSQL* sql_);
+    ~SqlStmtCache();
+
+    SqlStmtCache(const SqlStmtCache&) = delete;
+    SqlStmtCache& operator=(const SqlStmtCache&) = delete;
+
+    /* 执行语句，results 非空时取第一行结果：返回 1 有结果，0 无结果；
+     * results 为空时返回影响的行数；出错返回 -1。连接中断时重连并重试一次，
+     * 事务中重连会丢失之前的语句，此时传 retry = false 由调用方处理 */
+    int execute(SQL_STMT id, MYSQL_BIND* params, MYSQL_BIND* results = nullptr, bool retry = true);
+
+    void reset();                                       // 关闭所有已准备的语句
+
+    static bool is_conn_error(unsigned int err);        // 连接断开或语句句柄失效
+
+private:
+    MYSQL_STMT* prepare(SQL_STMT id);
+    bool reconnect();
+
+    MYSQL* sql;
+    unsigned long thread_id;                            // 准备语句时的连接线程号，重连后会变化
+    MYSQL_STMT* stmts[STMT_NUM];
+
+    static const char* const QUERIES[STMT_NUM];
+};
+
+
+#endif
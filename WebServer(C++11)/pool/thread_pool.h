@@ -9,35 +9,63 @@
 #define THREAD_POOL_H
 
 #include <mutex>
-#include <condition_variable>
 #include <queue>
+#include <deque>
 #include <thread>
 #include <functional>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <assert.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
+#include "mpmc_queue.h"
+
+/* 定长任务记录，如 {连接槽, 代数, 读/写}，由线程池统一的处理函数分发，
+ * 入队出队都只是拷贝到预分配的环形队列中，没有类型擦除和堆分配 */
+struct PoolTask {
+    void* arg;                                                              // 任务对象
+    uint32_t gen;                                                           // 任务对象的代数，用于识别过期任务
+    uint32_t op;                                                            // 操作码
+};
+
+typedef void (*TaskHandler)(void* ctx, const PoolTask& task);
+typedef std::function<void(size_t)> ThreadInit;                            // 子线程启动时调用，参数为线程编号
+
+/* 线程池运行统计 */
+struct PoolStats {
+    uint64_t steals;                                                        // 从其他线程队列中窃取的任务数
+    uint64_t parks;                                                         // 线程挂起次数
+    size_t queued;                                                          // 当前排队的任务数
+    size_t max_queued;                                                      // 单个线程队列的最大长度
+};
+
+/* 工作窃取线程池：每个子线程有自己的无锁队列，定长任务提交到当前子线程（在子线程中提交时）
+ * 或随机两个子线程中较空闲的一个；子线程先取自己的队列，空了再从其他子线程窃取，
+ * 仍然没有任务时先自旋一小段时间，再挂起在 futex 上，提交方只在目标线程挂起时才唤醒。
+ * 队列全满的定长任务和通用任务（add_task）放入加锁的共享队列。
+ * 子线程队列是先进先出的多生产者环形队列而不是只允许所有者入队的双端队列（Chase-Lev）：
+ * 读写任务由主线程提交、验证结果由数据库线程提交，都不是队列的所有者；积压时也是最早的请求先处理 */
 class ThreadPool {
 public:
     ThreadPool() = default;
     ThreadPool(ThreadPool&&) = default;
 
-    /* 构造函数，创建子线程并分离运行 */
-    explicit ThreadPool(size_t thread_count = 8): pool_ptr(std::make_shared<Pool>()) {
+    /* 构造函数，创建子线程并分离运行，queue_size 为每个子线程队列的容量，init 可用于绑定 CPU */
+    explicit ThreadPool(size_t thread_count = 8, size_t queue_size = 1024, ThreadInit init = nullptr): pool_ptr(std::make_shared<Pool>()) {
         assert(thread_count > 0);
+        assert(queue_size > 0 && (queue_size & (queue_size - 1)) == 0);
+        for(size_t i = 0; i < thread_count; i++) {
+            pool_ptr->workers.emplace_back(new Worker(queue_size));
+        }
         for(size_t i = 0; i < thread_count; i++) {
-            /* 匿名函数方式创建，pool 为子线程内的智能指针，用于访问同一个任务队列 */
-            std::thread([pool = pool_ptr] {
-                /* 子线程对任务队列操作时需加锁 */
-                std::unique_lock<std::mutex> locker(pool->mtx);
-                while(true) {
-                    if(!pool->tasks.empty()) {
-                        auto task = std::move(pool->tasks.front());         // 转移任务对象
-                        pool->tasks.pop();
-                        locker.unlock();
-                        task();                                             // 处理任务
-                        locker.lock();
-                    }
-                    else if(pool->is_closed) break;                         // 线程池关闭，子线程停止运行
-                    else pool->cond.wait(locker);
-                }
+            /* pool 为子线程内的智能指针，线程池对象析构后子线程仍可安全退出 */
+            std::thread([pool = pool_ptr, i, init] {
+                if(init) { init(i); }
+                run(pool, i);
             }).detach();
         }
     }
@@ -45,32 +73,237 @@ public:
     /* 析构函数，线程池引用计数不为零时，通知所有子线程关闭 */
     ~ThreadPool() {
         if(static_cast<bool>(pool_ptr)) {
-            {
-                std::lock_guard<std::mutex> locker(pool_ptr->mtx);
-                pool_ptr->is_closed = true;
+            pool_ptr->is_closed.store(true);
+            for(auto& worker : pool_ptr->workers) {
+                wake(*worker);
             }
-            pool_ptr->cond.notify_all();
         }
     }
 
     template<class F>
-    /* 向任务队列中添加新的任务 */
+    /* 向共享队列中添加新的通用任务 */
     void add_task(F&& task) {
         {
             std::lock_guard<std::mutex> locker(pool_ptr->mtx);
             pool_ptr->tasks.emplace(std::forward<F>(task));                 // 右值引用
+            pool_ptr->pending.fetch_add(1);
         }
-        pool_ptr->cond.notify_one();                                        // 通知一个子线程进行处理
+        wake_one(*pool_ptr);
+    }
+
+    /* 设置定长任务的处理函数，需在提交定长任务之前调用 */
+    void set_handler(TaskHandler handler, void* ctx) {
+        std::lock_guard<std::mutex> locker(pool_ptr->mtx);
+        pool_ptr->handler = handler;
+        pool_ptr->ctx = ctx;
+    }
+
+    /* 提交定长任务，目标队列满时依次尝试其他队列，全部满时放入共享队列 */
+    void post_task(void* arg, uint32_t gen, uint32_t op) {
+        Pool& pool = *pool_ptr;
+        assert(pool.handler);
+        const PoolTask task = {arg, gen, op};
+        const size_t n = pool.workers.size();
+        size_t target = local_pool == &pool ? local_index : pick(pool);
+
+        bool pushed = false;
+        for(size_t i = 0; i < n && !pushed; i++) {
+            pushed = pool.workers[target]->queue.push(task);
+            if(!pushed) { target = (target + 1) % n; }
+        }
+        if(!pushed) {
+            std::lock_guard<std::mutex> locker(pool.mtx);
+            pool.overflow.push_back(task);
+            pool.pending.fetch_add(1);
+        }
+
+        size_t depth = pool.workers[target]->queue.size();
+        size_t max_depth = pool.max_depth.load(std::memory_order_relaxed);
+        if(depth > max_depth) {
+            pool.max_depth.compare_exchange_strong(max_depth, depth, std::memory_order_relaxed);
+        }
+
+        /* 目标线程挂起则唤醒它；否则目标线程有积压时唤醒一个空闲线程来窃取 */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(!wake(*pool.workers[target]) && (depth > 1 || !pushed)) {
+            wake_one(pool);
+        }
+    }
+
+    PoolStats stats() const {
+        PoolStats st = {0, 0, 0, 0};
+        for(auto& worker : pool_ptr->workers) {
+            st.steals += worker->steals.load(std::memory_order_relaxed);
+            st.parks += worker->parks.load(std::memory_order_relaxed);
+            st.queued += worker->queue.size();
+        }
+        st.queued += pool_ptr->pending.load(std::memory_order_relaxed);
+        st.max_queued = pool_ptr->max_depth.load(std::memory_order_relaxed);
+        return st;
     }
 
 private:
+    /* 子线程定义 */
+    struct Worker {
+        explicit Worker(size_t queue_size) : queue(queue_size) {}
+        MpmcQueue<PoolTask> queue;                                          // 定长任务队列，其他子线程可从中窃取
+        alignas(64) std::atomic<uint32_t> sleeping{0};                      // 1：已挂起（futex 等待的字）
+        std::atomic<uint64_t> steals{0};
+        std::atomic<uint64_t> parks{0};
+    };
+
     /* 线程池定义 */
     struct Pool {
-        bool is_closed;                                                     // 是否关闭线程池
-        std::mutex mtx;                                                     // 访问任务队列的互斥锁
-        std::condition_variable cond;                                       // 任务队列的信号量
-        std::queue<std::function<void()>> tasks;                            // 任务队列，对象为函数对象
+        std::atomic<bool> is_closed{false};                                 // 是否关闭线程池
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<int> parked{0};                                         // 挂起的子线程数
+        std::mutex mtx;                                                     // 访问共享队列的互斥锁
+        std::queue<std::function<void()>> tasks;                            // 通用任务队列，对象为函数对象，用于不频繁的任务
+        std::deque<PoolTask> overflow;                                      // 各子线程队列都满时的定长任务
+        std::atomic<size_t> pending{0};                                     // 共享队列中的任务数
+        std::atomic<size_t> max_depth{0};
+        TaskHandler handler = nullptr;                                      // 定长任务的处理函数
+        void* ctx = nullptr;
     };
+
+    static const int SPIN_COUNT = 64;                                       // 挂起前的自旋次数
+
+    /* 当前线程所属的线程池和编号，用于在子线程中提交任务时放入自己的队列 */
+    static inline thread_local Pool* local_pool = nullptr;
+    static inline thread_local size_t local_index = 0;
+
+    static uint32_t next_random() {
+        static thread_local uint32_t seed = 2463534242u ^ (uint32_t)(uintptr_t)&seed;
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+
+    /* 随机选两个子线程，取负载较轻的一个；队列长度相同时优先未挂起的，省去一次唤醒 */
+    static size_t load_of(const Worker& worker) {
+        return worker.queue.size() * 2 + worker.sleeping.load(std::memory_order_relaxed);
+    }
+
+    static size_t pick(Pool& pool) {
+        size_t n = pool.workers.size();
+        size_t a = next_random() % n, b = next_random() % n;
+        return load_of(*pool.workers[b]) < load_of(*pool.workers[a]) ? b : a;
+    }
+
+    static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    static void futex_wait(std::atomic<uint32_t>* addr, uint32_t val) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0);
+    }
+
+    static void futex_wake(std::atomic<uint32_t>* addr) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+    /* 唤醒挂起的子线程，返回是否确实唤醒了 */
+    static bool wake(Worker& worker) {
+        if(worker.sleeping.load(std::memory_order_relaxed) && worker.sleeping.exchange(0)) {
+            futex_wake(&worker.sleeping);
+            return true;
+        }
+        return false;
+    }
+
+    static void wake_one(Pool& pool) {
+        if(pool.parked.load() == 0) {
+            return;
+        }
+        for(auto& worker : pool.workers) {
+            if(wake(*worker)) { return; }
+        }
+    }
+
+    static bool has_work(Pool& pool) {
+        for(auto& worker : pool.workers) {
+            if(worker->queue.size() > 0) { return true; }
+        }
+        return pool.pending.load() > 0;
+    }
+
+    /* 依次从自己的队列、其他子线程的队列、共享队列中取一个任务执行 */
+    static bool run_one(Pool& pool, size_t index) {
+        PoolTask task;
+        Worker& self = *pool.workers[index];
+        if(self.queue.pop(task)) {
+            pool.handler(pool.ctx, task);
+            return true;
+        }
+        size_t n = pool.workers.size();
+        size_t start = next_random() % n;
+        for(size_t i = 0; i < n; i++) {
+            size_t victim = (start + i) % n;
+            if(victim != index && pool.workers[victim]->queue.pop(task)) {
+                self.steals.fetch_add(1, std::memory_order_relaxed);
+                pool.handler(pool.ctx, task);
+                return true;
+            }
+        }
+        if(pool.pending.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+
+        std::function<void()> func;
+        {
+            std::lock_guard<std::mutex> locker(pool.mtx);
+            if(!pool.overflow.empty()) {
+                task = pool.overflow.front();
+                pool.overflow.pop_front();
+            }
+            else if(!pool.tasks.empty()) {
+                func = std::move(pool.tasks.front());                       // 转移任务对象
+                pool.tasks.pop();
+            }
+            else {
+                return false;
+            }
+            pool.pending.fetch_sub(1);
+        }
+        if(func) { func(); }
+        else { pool.handler(pool.ctx, task); }
+        return true;
+    }
+
+    /* 子线程主循环 */
+    static void run(std::shared_ptr<Pool> pool, size_t index) {
+        local_pool = pool.get();
+        local_index = index;
+        Worker& self = *pool->workers[index];
+        while(true) {
+            if(run_one(*pool, index)) { continue; }
+            if(pool->is_closed.load()) { break; }                           // 线程池关闭，子线程停止运行
+
+            bool found = false;
+            for(int i = 0; i < SPIN_COUNT && !found; i++) {
+                cpu_relax();
+                found = run_one(*pool, index);
+            }
+            if(found) { continue; }
+
+            /* 先标记挂起再检查一次队列，与提交方“先入队再检查标记”配对，不会漏掉唤醒 */
+            self.sleeping.store(1);
+            pool->parked.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(!has_work(*pool) && !pool->is_closed.load()) {
+                self.parks.fetch_add(1, std::memory_order_relaxed);
+                futex_wait(&self.sleeping, 1);
+            }
+            self.sleeping.store(0);
+            pool->parked.fetch_sub(1);
+        }
+    }
+
     std::shared_ptr<Pool> pool_ptr;
 };
 
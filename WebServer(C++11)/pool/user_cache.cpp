@@ -0,0 +1,113 @@
+/*
+ * @Description  : 用户凭据缓存
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 22:40:15
+ * @Last update  : 2026-10-18 22:40:15
+ */
+
+#include "user_cache.h"
+using namespace std;
+
+UserCache::UserCache() : max_entries(0), ttl(0), negative_ttl(0), hits(0), misses(0), coalesced(0) {}
+
+/* 获取用户缓存的唯一实例 */
+UserCache* UserCache::get_instance() {
+    static UserCache cache;
+    return &cache;
+}
+
+void UserCache::init(size_t max_entries_, int ttl_ms, int negative_ttl_ms) {
+    lock_guard<mutex> locker(mtx);
+    max_entries = max_entries_;
+    ttl = chrono::milliseconds(ttl_ms);
+    negative_ttl = chrono::milliseconds(negative_ttl_ms);
+}
+
+UserCache::LOOKUP UserCache::lookup(const string& name, UserRecord& record, const Waiter& waiter) {
+    lock_guard<mutex> locker(mtx);
+    auto it = entries.find(name);
+    if(it != entries.end()) {
+        if(chrono::steady_clock::now() < it->second->expire) {
+            lru.splice(lru.begin(), lru, it->second);
+            record = it->second->record;
+            hits++;
+            return HIT;
+        }
+        lru.erase(it->second);
+        entries.erase(it);
+    }
+
+    auto flight = flights.find(name);
+    if(flight != flights.end()) {
+        flight->second.waiters.push_back(waiter);
+        coalesced++;
+        return WAIT;
+    }
+    flights.emplace(name, Flight());
+    misses++;
+    return LOAD;
+}
+
+void UserCache::complete(const string& name, bool ok, const UserRecord& record) {
+    vector<Waiter> waiters;
+    {
+        lock_guard<mutex> locker(mtx);
+        auto flight = flights.find(name);
+        if(flight == flights.end()) { return; }
+        waiters.swap(flight->second.waiters);
+        bool stale = flight->second.stale;
+        flights.erase(flight);
+
+        if(ok && !stale && max_entries > 0) {
+            auto it = entries.find(name);
+            if(it != entries.end()) {
+                lru.erase(it->second);
+                entries.erase(it);
+            }
+            auto expire = chrono::steady_clock::now() + (record.exists ? ttl : negative_ttl);
+            lru.push_front({name, record, expire});
+            entries[name] = lru.begin();
+            while(entries.size() > max_entries) {
+                entries.erase(lru.back().name);
+                lru.pop_back();
+            }
+        }
+    }
+    /* 回调会投递任务或唤醒其他线程，不在锁内执行 */
+    for(Waiter& waiter : waiters) {
+        waiter(ok, record);
+    }
+}
+
+void UserCache::invalidate(const string& name) {
+    lock_guard<mutex> locker(mtx);
+    auto it = entries.find(name);
+    if(it != entries.end()) {
+        lru.erase(it->second);
+        entries.erase(it);
+    }
+    auto flight = flights.find(name);
+    if(flight != flights.end()) {
+        flight->second.stale = true;
+    }
+}
+
+void UserCache::clear() {
+    lock_guard<mutex> locker(mtx);
+    entries.clear();
+    lru.clear();
+}
+
+UserCacheStats UserCache::stats() {
+    UserCacheStats st = {hits.load(memory_order_relaxed), misses.load(memory_order_relaxed),
+                         coalesced.load(memory_order_relaxed), 0};
+    lock_guard<mutex> locker(mtx);
+    st.entries = entries.size();
+    return st;
+}
+
+void UserCache::log_stats() {
+    UserCacheStats st = stats();
+    LOG_INFO("UserCache entries:%zu, hits:%lu, misses:%lu, coalesced:%lu", st.entries,
+             (unsigned long)st.hits, (unsigned long)st.misses, (unsigned long)st.coalesced);
+}
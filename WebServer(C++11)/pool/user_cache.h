@@ -0,0 +1,105 @@
+/*
+ * @Description  : 用户凭据缓存
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 22:40:15
+ * @Last update  : 2026-10-18 22:40:15
+ */
+
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+
+
+#include <string>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "../log/log.h"
+
+/* 一个用户名的查询结果，不存在的用户也会被缓存 */
+struct UserRecord {
+    UserRecord() : exists(false) {}
+
+    bool exists;
+    std::string passwd;
+};
+
+/* 用户缓存运行统计 */
+struct UserCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t coalesced;                                 // 合并到进行中查询的请求数
+    size_t entries;                                     // 当前缓存的条目数
+};
+
+/* 进程内的用户名 -> 凭据缓存，LRU 淘汰，条目数有上限，存在的用户和不存在的用户分别有各自的过期时间。
+ * 同一用户名并发未命中时只有第一个请求去查询数据库，其余请求登记回调，查询完成后一起得到结果 */
+class UserCache {
+public:
+    /* ok 为 false 表示查询失败，record 无意义 */
+    typedef std::function<void(bool ok, const UserRecord& record)> Waiter;
+
+    enum LOOKUP {
+        HIT,                                            // 命中，结果已写入 record
+        WAIT,                                           // 已有相同用户名的查询在进行，waiter 将在其完成时被调用
+        LOAD,                                           // 未命中，调用方负责查询并调用 complete
+    };
+
+    static UserCache* get_instance();
+
+    /* max_entries 为 0 时不缓存，但并发查询仍然合并 */
+    void init(size_t max_entries, int ttl_ms, int negative_ttl_ms);
+
+    LOOKUP lookup(const std::string& name, UserRecord& record, const Waiter& waiter);
+
+    /* 结束 LOAD 返回的查询：成功时写入缓存，然后在调用线程上执行所有等待的回调 */
+    void complete(const std::string& name, bool ok, const UserRecord& record);
+
+    /* 用户信息发生变化（注册成功）时删除缓存；进行中的查询结果不再写入缓存 */
+    void invalidate(const std::string& name);
+
+    void clear();
+
+    UserCacheStats stats();
+    void log_stats();
+
+private:
+    UserCache();
+    ~UserCache() = default;
+
+    struct Entry {
+        std::string name;
+        UserRecord record;
+        std::chrono::steady_clock::time_point expire;
+    };
+
+    /* 进行中的查询 */
+    struct Flight {
+        Flight() : stale(false) {}
+
+        std::vector<Waiter> waiters;
+        bool stale;                                     // 查询期间被 invalidate，结果不写入缓存
+    };
+
+    typedef std::list<Entry> LruList;
+
+    size_t max_entries;
+    std::chrono::milliseconds ttl;
+    std::chrono::milliseconds negative_ttl;
+
+    std::mutex mtx;
+    LruList lru;                                        // 表头为最近使用
+    std::unordered_map<std::string, LruList::iterator> entries;
+    std::unordered_map<std::string, Flight> flights;
+
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> coalesced;                    // 合并到进行中查询的请求数
+};
+
+
+#endif
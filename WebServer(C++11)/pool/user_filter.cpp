@@ -0,0 +1,163 @@
+/*
+ * @Description  : 已注册用户名的布隆过滤器
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 23:25:08
+ * @Last update  : 2026-10-18 23:25:08
+ */
+
+#include "user_filter.h"
+#include "sql_executor.h"
+using namespace std;
+
+/* 两个独立的 64 位哈希，第 i 个位置为 h1 + i * h2 */
+static void hash_name(const string& name, uint64_t& h1, uint64_t& h2) {
+    h1 = std::hash<string>()(name);
+    h2 = 14695981039346656037ULL;                       // FNV-1a
+    for(unsigned char c : name) {
+        h2 = (h2 ^ c) * 1099511628211ULL;
+    }
+    h2 |= 1;
+}
+
+UserFilter::Bits::Bits(size_t capacity_) : capacity(capacity_), count(0) {
+    size_t words_num = (capacity * BITS_PER_NAME + 63) / 64;
+    words = vector<atomic<uint64_t>>(words_num);
+    for(auto& word : words) {
+        word.store(0, memory_order_relaxed);
+    }
+    nbits = words_num * 64;
+}
+
+void UserFilter::Bits::add(const string& name) {
+    uint64_t h1, h2;
+    hash_name(name, h1, h2);
+    for(int i = 0; i < HASH_NUM; i++) {
+        size_t bit = (h1 + i * h2) % nbits;
+        words[bit / 64].fetch_or(1ULL << (bit % 64), memory_order_relaxed);
+    }
+    count.fetch_add(1, memory_order_relaxed);
+}
+
+bool UserFilter::Bits::test(const string& name) const {
+    uint64_t h1, h2;
+    hash_name(name, h1, h2);
+    for(int i = 0; i < HASH_NUM; i++) {
+        size_t bit = (h1 + i * h2) % nbits;
+        if(!(words[bit / 64].load(memory_order_relaxed) & (1ULL << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+UserFilter::UserFilter() : building(false), rebuild(3600), checks(0), skipped(0) {}
+
+UserFilter* UserFilter::get_instance() {
+    static UserFilter filter;
+    return &filter;
+}
+
+void UserFilter::init(int rebuild_s) {
+    lock_guard<mutex> locker(mtx);
+    rebuild = chrono::seconds(rebuild_s);
+}
+
+bool UserFilter::build(MYSQL* sql) {
+    if(!sql) { return false; }
+    size_t rows = 0;
+    if(mysql_query(sql, "SELECT COUNT(*) FROM user") == 0) {
+        MYSQL_RES* res = mysql_store_result(sql);
+        if(res) {
+            MYSQL_ROW row = mysql_fetch_row(res);
+            if(row && row[0]) { rows = strtoull(row[0], nullptr, 10); }
+            mysql_free_result(res);
+        }
+    }
+    size_t capacity = rows * 2 > MIN_CAPACITY ? rows * 2 : MIN_CAPACITY;           // 为之后的注册预留一倍空间
+    shared_ptr<Bits> bits = make_shared<Bits>(capacity);
+    {
+        lock_guard<mutex> locker(mtx);
+        building = true;
+        next = bits;
+    }
+
+    /* 逐行读取，不在客户端缓存整个结果集 */
+    bool ok = mysql_query(sql, "SELECT username FROM user") == 0;
+    MYSQL_RES* res = ok ? mysql_use_result(sql) : nullptr;
+    if(res) {
+        while(MYSQL_ROW row = mysql_fetch_row(res)) {
+            unsigned long* lens = mysql_fetch_lengths(res);
+            if(row[0]) { bits->add(lens ? string(row[0], lens[0]) : string(row[0])); }
+        }
+        ok = mysql_errno(sql) == 0;
+        mysql_free_result(res);
+    }
+    else {
+        ok = false;
+    }
+
+    lock_guard<mutex> locker(mtx);
+    if(ok) {
+        current = bits;
+        built = chrono::steady_clock::now();
+        LOG_INFO("UserFilter built, names:%zu, capacity:%zu", bits->count.load(), bits->capacity);
+    }
+    else {
+        LOG_ERROR("UserFilter build error: %s", mysql_error(sql));
+        built = chrono::steady_clock::now();        // 失败后同样等待一个周期再重试
+    }
+    next = nullptr;
+    building = false;
+    return ok;
+}
+
+bool UserFilter::maybe_contains(const string& name) {
+    shared_ptr<Bits> bits;
+    bool due = false;
+    {
+        lock_guard<mutex> locker(mtx);
+        bits = current;
+        if(!building && bits && (chrono::steady_clock::now() - built > rebuild ||
+                                 bits->count.load(memory_order_relaxed) > bits->capacity)) {
+            building = due = true;
+        }
+    }
+    if(due) {
+        bool submitted = SqlExecutor::get_instance()->submit([this](MYSQL* sql) {
+            if(!build(sql)) {
+                lock_guard<mutex> locker(mtx);
+                building = false;
+            }
+        });
+        if(!submitted) {
+            lock_guard<mutex> locker(mtx);
+            building = false;
+        }
+    }
+    checks++;
+    if(!bits) { return true; }
+    if(bits->test(name)) { return true; }
+    skipped++;
+    return false;
+}
+
+void UserFilter::add(const string& name) {
+    shared_ptr<Bits> bits, pending;
+    {
+        lock_guard<mutex> locker(mtx);
+        bits = current;
+        pending = next;
+    }
+    if(bits) { bits->add(name); }
+    if(pending) { pending->add(name); }
+}
+
+void UserFilter::log_stats() {
+    size_t names = 0;
+    {
+        lock_guard<mutex> locker(mtx);
+        if(current) { names = current->count.load(); }
+    }
+    LOG_INFO("UserFilter names:%zu, checks:%lu, skipped:%lu", names,
+             (unsigned long)checks, (unsigned long)skipped);
+}
@@ -0,0 +1,73 @@
+/*
+ * @Description  : 已注册用户名的布隆过滤器
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 23:25:08
+ * @Last update  : 2026-10-18 23:25:08
+ */
+
+#ifndef USER_FILTER_H
+#define USER_FILTER_H
+
+
+#include <mysql/mysql.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "../log/log.h"
+
+/* 注册时判断用户名是否“一定不存在”：过滤器说不存在时跳过查询直接 INSERT，说可能存在时仍查询数据库。
+ * 启动时流式扫描 user 表建立，注册成功后加入；距上次建立超过 rebuild 秒或元素数超过容量时，
+ * 由下一次注册在数据库线程上重建，重建期间新加入的用户名同时写入新旧两个过滤器 */
+class UserFilter {
+public:
+    static UserFilter* get_instance();
+
+    void init(int rebuild_s);
+
+    /* 在持有 sql 的线程上扫描 user 表重建过滤器，失败时保留原过滤器 */
+    bool build(MYSQL* sql);
+
+    /* 尚未建立时总是返回 true */
+    bool maybe_contains(const std::string& name);
+    void add(const std::string& name);
+
+    void log_stats();
+
+private:
+    UserFilter();
+    ~UserFilter() = default;
+
+    /* 位数组，双重哈希生成 HASH_NUM 个位置，位的读写都是原子操作，不加锁 */
+    struct Bits {
+        explicit Bits(size_t capacity_);
+
+        void add(const std::string& name);
+        bool test(const std::string& name) const;
+
+        std::vector<std::atomic<uint64_t>> words;
+        size_t nbits;
+        size_t capacity;                                // 误判率达到设计值时的元素数
+        std::atomic<size_t> count;
+    };
+
+    static const int HASH_NUM = 7;                      // 每个元素 10 位、7 个哈希，误判率约 1%
+    static const size_t BITS_PER_NAME = 10;
+    static const size_t MIN_CAPACITY = 1 << 16;
+
+    std::mutex mtx;
+    std::shared_ptr<Bits> current;                      // 为 nullptr 时尚未建立
+    std::shared_ptr<Bits> next;                         // 重建中的过滤器
+    bool building;
+    std::chrono::seconds rebuild;
+    std::chrono::steady_clock::time_point built;
+
+    std::atomic<uint64_t> checks;
+    std::atomic<uint64_t> skipped;                      // 判定为一定不存在、省去查询的次数
+};
+
+
+#endif
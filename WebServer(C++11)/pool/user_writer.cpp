@@ -0,0 +1,213 @@
+/*
+ * @Description  : 注册用户的批量写入
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-19 00:10:26
+ * @Last update  : 2026-10-19 00:10:26
+ */
+
+#include <future>
+#include <string.h>
+#include "user_writer.h"
+#include "user_filter.h"
+#include "sql_executor.h"
+#include "sql_stmt_cache.h"
+#include "sql_connection_pool.h"
+using namespace std;
+
+UserWriter::UserWriter() : mode(WRITE_SYNC), flush_interval(10), batch_rows(256), max_pending(65536), max_retries(3),
+        is_closed(true), batches(0), written(0), failed(0) {}
+
+UserWriter* UserWriter::get_instance() {
+    static UserWriter user_writer;
+    return &user_writer;
+}
+
+void UserWriter::init(int mode_, int flush_ms, size_t batch_rows_, size_t max_pending_, int max_retries_) {
+    assert(flush_ms > 0 && batch_rows_ > 0);
+    lock_guard<mutex> locker(mtx);
+    if(!is_closed || mode_ == WRITE_SYNC) { return; }
+    mode = mode_;
+    flush_interval = chrono::milliseconds(flush_ms);
+    batch_rows = batch_rows_;
+    max_pending = max_pending_;
+    max_retries = max_retries_;
+    is_closed = false;
+    writer = thread(&UserWriter::run, this);
+}
+
+void UserWriter::stop() {
+    {
+        lock_guard<mutex> locker(mtx);
+        if(is_closed) { return; }
+        is_closed = true;
+    }
+    cond.notify_all();
+    if(writer.joinable()) { writer.join(); }
+}
+
+UserWriter::RESERVE UserWriter::reserve(const string& name, const string& pwd, const Done& done) {
+    {
+        lock_guard<mutex> locker(mtx);
+        if(is_closed || pending.size() >= max_pending) { return FULL; }
+        if(!pending.emplace(name, pwd).second) { return DUPLICATE; }
+        rows.push_back({name, pwd, mode == WRITE_BATCH ? done : Done(), 0});
+        if(rows.size() >= batch_rows) { cond.notify_one(); }
+    }
+    UserFilter::get_instance()->add(name);
+    UserCache::get_instance()->invalidate(name);
+    if(mode == WRITE_BEHIND) { done(true); }
+    return RESERVED;
+}
+
+bool UserWriter::find(const string& name, UserRecord& record) {
+    lock_guard<mutex> locker(mtx);
+    if(pending.empty()) { return false; }
+    auto it = pending.find(name);
+    if(it == pending.end()) { return false; }
+    record.exists = true;
+    record.passwd = it->second;
+    return true;
+}
+
+void UserWriter::run() {
+    unique_lock<mutex> locker(mtx);
+    while(true) {
+        cond.wait_for(locker, flush_interval, [this] { return is_closed || rows.size() >= batch_rows; });
+        if(rows.empty()) {
+            if(is_closed) { break; }
+            continue;
+        }
+        auto batch = make_shared<vector<Row>>();
+        batch->swap(rows);
+        bool closing = is_closed;
+        locker.unlock();
+
+        /* 在数据库线程上写入，写完之前不取下一批，同一用户名的重试不会越过之后的批次 */
+        auto finished = make_shared<promise<void>>();
+        future<void> done = finished->get_future();
+        bool submitted = SqlExecutor::get_instance()->submit([this, batch, finished](MYSQL* sql) {
+            flush(sql, *batch);
+            finished->set_value();
+        });
+        if(submitted) {
+            done.wait();
+        }
+        else if(closing) {
+            LOG_ERROR("UserWriter SqlExecutor is closed, %zu users not written!", batch->size());
+            for(Row& row : *batch) { finish(row, false); }
+        }
+        else {
+            LOG_WARN("UserWriter SqlExecutor is busy, retry %zu users later", batch->size());
+        }
+
+        locker.lock();
+        if(!submitted && !closing) {
+            rows.insert(rows.begin(), make_move_iterator(batch->begin()), make_move_iterator(batch->end()));
+            cond.wait_for(locker, flush_interval);
+        }
+    }
+}
+
+/* 每 batch_rows 行一个事务；连接错误时整批留待重试，其他错误（如用户名重复）逐行写入找出失败的行 */
+void UserWriter::flush(MYSQL* sql, vector<Row>& batch) {
+    vector<Row> retry;
+    for(size_t begin = 0; begin < batch.size(); begin += batch_rows) {
+        size_t n = min(batch_rows, batch.size() - begin);
+        Row* chunk = &batch[begin];
+        batches++;
+        bool conn_error = !sql;
+        if(sql && insert_rows(sql, chunk, n, conn_error)) {
+            for(size_t i = 0; i < n; i++) { finish(chunk[i], true); }
+            continue;
+        }
+        for(size_t i = 0; i < n; i++) {
+            Row& row = chunk[i];
+            if(n > 1 && sql && insert_rows(sql, &row, 1, conn_error)) {
+                finish(row, true);
+                continue;
+            }
+            if(conn_error && ++row.retries <= max_retries) {
+                retry.push_back(std::move(row));
+                continue;
+            }
+            LOG_ERROR("UserWriter insert %s failed%s", row.name.c_str(), sql ? "" : ": no connection");
+            finish(row, false);
+        }
+    }
+    if(!retry.empty()) {
+        if(sql) { mysql_ping(sql); }                                    // 按 MYSQL_OPT_RECONNECT 重连
+        lock_guard<mutex> locker(mtx);
+        rows.insert(rows.begin(), make_move_iterator(retry.begin()), make_move_iterator(retry.end()));
+    }
+}
+
+/* 关闭自动提交，逐行执行连接上缓存的 INSERT 预处理语句（参数二进制绑定，不转义拼接），全部成功才提交 */
+bool UserWriter::insert_rows(MYSQL* sql, const Row* batch, size_t n, bool& conn_error) {
+    conn_error = false;
+    SqlStmtCache* stmts = SqlConnPool::get_instance()->get_stmts(sql);
+    if(!stmts) { return false; }
+    if(mysql_autocommit(sql, 0)) {
+        conn_error = SqlStmtCache::is_conn_error(mysql_errno(sql));
+        return false;
+    }
+    unsigned long thread_id = mysql_thread_id(sql);
+
+    bool ok = true;
+    MYSQL_BIND params[2];
+    unsigned long lens[2];
+    for(size_t i = 0; ok && i < n; i++) {
+        memset(params, 0, sizeof(params));
+        const string* fields[2] = {&batch[i].name, &batch[i].pwd};
+        for(int k = 0; k < 2; k++) {
+            lens[k] = fields[k]->size();
+            params[k].buffer_type = MYSQL_TYPE_STRING;
+            params[k].buffer = const_cast<char*>(fields[k]->data());
+            params[k].buffer_length = lens[k];
+            params[k].length = &lens[k];
+        }
+        ok = stmts->execute(STMT_INSERT_USER, params, nullptr, false) >= 0;
+    }
+    if(ok && mysql_commit(sql)) {
+        LOG_ERROR("UserWriter commit error: %s", mysql_error(sql));
+        ok = false;
+    }
+
+    /* 事务中连接断开后被自动重连时，之前的行已随旧连接回滚，提交不代表写入 */
+    if(mysql_thread_id(sql) != thread_id) {
+        ok = false;
+        conn_error = true;
+    }
+    else if(!ok) {
+        conn_error = SqlStmtCache::is_conn_error(mysql_errno(sql));
+    }
+    if(!ok) { mysql_rollback(sql); }
+    mysql_autocommit(sql, 1);
+    return ok;
+}
+
+void UserWriter::finish(Row& row, bool pass) {
+    {
+        lock_guard<mutex> locker(mtx);
+        pending.erase(row.name);
+    }
+    /* 写入前可能有登录查询得到“用户不存在”的结果，写入后再次使缓存失效 */
+    UserCache::get_instance()->invalidate(row.name);
+    if(pass) {
+        written++;
+    }
+    else {
+        failed++;
+        if(!row.done) { LOG_ERROR("UserWriter lost registration of %s", row.name.c_str()); }
+    }
+    if(row.done) { row.done(pass); }
+}
+
+void UserWriter::log_stats() {
+    size_t waiting = 0;
+    {
+        lock_guard<mutex> locker(mtx);
+        waiting = pending.size();
+    }
+    LOG_INFO("UserWriter batches:%lu, written:%lu, failed:%lu, pending:%zu", (unsigned long)batches,
+             (unsigned long)written, (unsigned long)failed, waiting);
+}
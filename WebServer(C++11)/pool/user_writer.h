@@ -0,0 +1,92 @@
+/*
+ * @Description  : 注册用户的批量写入
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-19 00:10:26
+ * @Last update  : 2026-10-19 00:10:26
+ */
+
+#ifndef USER_WRITER_H
+#define USER_WRITER_H
+
+
+#include <mysql/mysql.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+#include "../log/log.h"
+#include "user_cache.h"
+
+enum USER_WRITE_MODE {
+    WRITE_SYNC = 0,                                     // 每个注册单独 INSERT，不经过 UserWriter
+    WRITE_BATCH,                                        // 批量 INSERT 提交后才响应，不丢数据
+    WRITE_BEHIND,                                       // 登记后立即响应，之后批量写入，进程崩溃会丢失最近 flush_ms 内的注册
+};
+
+/* 注册的用户名先登记在内存中（登录和重复注册都能立即看到），由后台线程每 flush_ms 毫秒或攒够 batch_rows 行时
+ * 把一批用户交给数据库线程，在一个事务中写入；整批失败时逐行重试，区分出失败的用户。
+ * 连接错误导致的失败在之后的批次中重试，超过 max_retries 次后放弃 */
+class UserWriter {
+public:
+    typedef std::function<void(bool pass)> Done;
+
+    enum RESERVE {
+        RESERVED,                                       // 已登记，done 在写入后（WRITE_BATCH）或立即（WRITE_BEHIND）被调用
+        DUPLICATE,                                      // 用户名已在等待写入，done 不会被调用
+        FULL,                                           // 未启用或等待写入的用户过多，由调用方同步插入
+    };
+
+    static UserWriter* get_instance();
+
+    void init(int mode, int flush_ms, size_t batch_rows, size_t max_pending = 65536, int max_retries = 3);
+    void stop();                                        // 写完所有已登记的用户后返回，须在 SqlExecutor 停止之前调用
+
+    bool enabled() const { return mode != WRITE_SYNC; }
+    RESERVE reserve(const std::string& name, const std::string& pwd, const Done& done);
+
+    /* 用户名已登记但尚未写入数据库 */
+    bool find(const std::string& name, UserRecord& record);
+
+    void log_stats();
+
+private:
+    UserWriter();
+    ~UserWriter() { stop(); }
+
+    struct Row {
+        std::string name;
+        std::string pwd;
+        Done done;                                      // WRITE_BEHIND 模式为空
+        int retries;
+    };
+
+    void run();
+    void flush(MYSQL* sql, std::vector<Row>& rows);
+    bool insert_rows(MYSQL* sql, const Row* rows, size_t n, bool& conn_error);
+    void finish(Row& row, bool pass);
+
+    int mode;
+    std::chrono::milliseconds flush_interval;
+    size_t batch_rows;
+    size_t max_pending;
+    int max_retries;
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::vector<Row> rows;                              // 等待写入的用户
+    std::unordered_map<std::string, std::string> pending;   // 已登记未写入的用户名 -> 密码，包括正在写入的
+    bool is_closed;
+    std::thread writer;
+
+    std::atomic<uint64_t> batches;
+    std::atomic<uint64_t> written;
+    std::atomic<uint64_t> failed;
+};
+
+
+#endif
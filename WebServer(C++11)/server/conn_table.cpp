@@ -0,0 +1,72 @@
+/*
+ * @Description  : 以 fd 为下标的连接表
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-17 13:20:06
+ * @Last update  : 2026-10-17 13:20:06
+ */
+
+#include "conn_table.h"
+#ifdef USE_NUMA
+#include <numa.h>
+#endif
+using namespace std;
+
+ConnTable::Chunk::Chunk(int base) {
+    for(int i = 0; i < CHUNK_SIZE; i++) {
+        slots[i].fd = base + i;
+        slots[i].gen.store(0, memory_order_relaxed);
+        slots[i].conn = &conns[i];
+        slots[i].sending = slots[i].closing = false;
+        slots[i].pool_state.store(0, memory_order_relaxed);
+        infos[i] = {};
+    }
+}
+
+#ifdef USE_NUMA
+/* 在当前线程所在的结点上分配，libnuma 不可用时退回普通分配 */
+void* ConnTable::Chunk::operator new(size_t size) {
+    void* ptr = nullptr;
+    if(numa_available() >= 0) { ptr = numa_alloc_local(size); }
+    else if(posix_memalign(&ptr, alignof(Chunk), size) != 0) { ptr = nullptr; }
+    if(!ptr) { throw bad_alloc(); }
+    return ptr;
+}
+
+void ConnTable::Chunk::operator delete(void* ptr, size_t size) {
+    if(numa_available() >= 0) { numa_free(ptr, size); }
+    else { free(ptr); }
+}
+#endif
+
+ConnTable::ConnTable(int max_fd_) : max_fd(max_fd_), chunks((max_fd_ + CHUNK_MASK) >> CHUNK_BITS) {
+    assert(max_fd > 0);
+}
+
+/* 占用 fd 对应的槽位并初始化连接，fd 超出上限时返回 nullptr */
+ConnSlot* ConnTable::open(int fd, const sockaddr_in& addr) {
+    if(fd < 0 || fd >= max_fd) { return nullptr; }
+    unique_ptr<Chunk>& chunk = chunks[fd >> CHUNK_BITS];
+    if(!chunk) {
+        chunk.reset(new Chunk(fd & ~CHUNK_MASK));
+    }
+    ConnSlot* slot = &chunk->slots[fd & CHUNK_MASK];
+    assert(!slot->is_open());
+
+    ConnInfo& ci = chunk->infos[fd & CHUNK_MASK];
+    ci.addr = addr;
+    ci.open_time = time(nullptr);
+    ci.requests = 0;
+
+    slot->conn->init(fd, addr);
+    slot->sending = slot->closing = false;
+    slot->pool_state.store(SLOT_ARMED, memory_order_relaxed);
+    slot->gen.fetch_add(1, memory_order_acq_rel);
+    return slot;
+}
+
+/* 释放槽位，gen 不匹配（已被释放过）时返回 false，保证同一连接只关闭一次 */
+bool ConnTable::release(ConnSlot* slot, uint32_t gen) {
+    assert(slot);
+    if(!(gen & 1)) { return false; }
+    return slot->gen.compare_exchange_strong(gen, gen + 1, memory_order_acq_rel);
+}
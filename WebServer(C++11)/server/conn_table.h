@@ -0,0 +1,108 @@
+/*
+ * @Description  : 以 fd 为下标的连接表
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-17 13:20:06
+ * @Last update  : 2026-10-17 13:20:06
+ */
+
+#ifndef CONN_TABLE_H
+#define CONN_TABLE_H
+
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <time.h>
+#include <assert.h>
+#include <netinet/in.h>
+
+#include "../http/http_connect.h"
+
+/* 线程池模式下连接的处理权：SLOT_ARMED 表示事件已注册、没有工作线程在处理，
+ * SLOT_EXPIRED 表示定时器已到期，由处理中的工作线程在重新注册事件前关闭连接 */
+enum : uint8_t { SLOT_ARMED = 1, SLOT_EXPIRED = 2 };
+
+/* 连接槽热数据：事件分发只访问这一个缓存行
+ * gen 为连接代数，打开和释放时各加一，奇数表示连接打开中；
+ * 线程池任务、定时器回调捕获打开时的 gen，执行前比较以丢弃过期回调 */
+struct alignas(64) ConnSlot {
+    int fd;
+    std::atomic<uint32_t> gen;
+    HttpConn* conn;                                     // 连接对象（含读写缓冲区），在连接表的生命周期内地址不变
+    bool sending;                                       // 完成通知模式下内核正在发送写缓冲区，此时推迟关闭
+    bool closing;                                       // 发送完成后关闭
+    std::atomic<uint8_t> pool_state;                    // SLOT_ARMED | SLOT_EXPIRED，只在线程池模式下使用
+
+    bool is_open() const { return gen.load(std::memory_order_acquire) & 1; }
+};
+
+/* 连接槽冷数据：地址和统计信息，只在建立、关闭连接时访问 */
+struct ConnInfo {
+    sockaddr_in addr;
+    time_t open_time;                                   // 建立连接的时间
+    uint64_t requests;                                  // 已处理的请求数
+};
+
+/* 预先按 fd 上限分配槽位索引，槽位按块惰性分配，分配后不再移动，
+ * 替代 unordered_map：查找无需哈希，插入不会 rehash 使其他线程持有的指针失效。
+ * open/get 只在所属事件循环线程调用，release 可在任意线程调用 */
+class ConnTable {
+public:
+    explicit ConnTable(int max_fd);
+    ~ConnTable() = default;
+
+    ConnSlot* open(int fd, const sockaddr_in& addr);
+    bool release(ConnSlot* slot, uint32_t gen);
+
+    /* fd 对应的打开中的连接，不存在时返回 nullptr */
+    ConnSlot* get(int fd) {
+        if(fd < 0 || fd >= max_fd) { return nullptr; }
+        Chunk* chunk = chunks[fd >> CHUNK_BITS].get();
+        if(!chunk) { return nullptr; }
+        ConnSlot* slot = &chunk->slots[fd & CHUNK_MASK];
+        return slot->is_open() ? slot : nullptr;
+    }
+
+    ConnInfo& info(const ConnSlot* slot) {
+        assert(slot && slot->fd >= 0 && slot->fd < max_fd);
+        return chunks[slot->fd >> CHUNK_BITS]->infos[slot->fd & CHUNK_MASK];
+    }
+
+    static bool alive(const ConnSlot* slot, uint32_t gen) {
+        return slot->gen.load(std::memory_order_acquire) == gen;
+    }
+
+    /* 遍历所有打开中的连接 */
+    template<typename F>
+    void for_each(F f) {
+        for(auto& chunk : chunks) {
+            if(!chunk) { continue; }
+            for(ConnSlot& slot : chunk->slots) {
+                if(slot.is_open()) { f(&slot); }
+            }
+        }
+    }
+
+private:
+    static const int CHUNK_BITS = 6;
+    static const int CHUNK_SIZE = 1 << CHUNK_BITS;
+    static const int CHUNK_MASK = CHUNK_SIZE - 1;
+
+    /* 块由所属事件循环线程在第一次用到时分配，内存落在该线程所在的 NUMA 结点 */
+    struct Chunk {
+        explicit Chunk(int base);
+#ifdef USE_NUMA
+        static void* operator new(size_t size);
+        static void operator delete(void* ptr, size_t size);
+#endif
+        ConnSlot slots[CHUNK_SIZE];
+        ConnInfo infos[CHUNK_SIZE];
+        HttpConn conns[CHUNK_SIZE];
+    };
+
+    int max_fd;
+    std::vector<std::unique_ptr<Chunk>> chunks;         // 大小固定为 max_fd / CHUNK_SIZE，不会扩容
+};
+
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * @Description  : CPU 绑定与 NUMA 拓扑
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 16:42:10
+ * @Last update  : 2026-10-18 16:42:10
+ */
+
+#include "cpu_affinity.h"
+#include <algorithm>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#ifdef USE_NUMA
+#include <numa.h>
+#endif
+using namespace std;
+
+CpuAffinity* CpuAffinity::get_instance() {
+    static CpuAffinity affinity;
+    return &affinity;
+}
+
+CpuAffinity::CpuAffinity() : nodes(1) {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if(sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for(int i = 0; i < CPU_SETSIZE; i++) {
+            if(CPU_ISSET(i, &mask)) { cpus.push_back(i); }
+        }
+    }
+    if(cpus.empty()) { cpus.push_back(0); }
+
+    /* 同一结点的 CPU 相邻，结点内保持编号顺序 */
+    stable_sort(cpus.begin(), cpus.end(), [](int a, int b) { return node_of(a) < node_of(b); });
+    set<int> node_set;
+    for(int c : cpus) { node_set.insert(node_of(c)); }
+    nodes = node_set.size();
+}
+
+bool CpuAffinity::bind(int cpu) {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+}
+
+/* CPU 所在的 NUMA 结点，无法获取时视为结点 0 */
+int CpuAffinity::node_of(int cpu) {
+#ifdef USE_NUMA
+    if(numa_available() >= 0) {
+        int node = numa_node_of_cpu(cpu);
+        return node < 0 ? 0 : node;
+    }
+#endif
+    /* sysfs 中 CPU 目录下有一个 nodeN 链接 */
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR* dir = opendir(path);
+    if(!dir) { return 0; }
+    int node = 0;
+    struct dirent* entry;
+    while((entry = readdir(dir)) != nullptr) {
+        if(strncmp(entry->d_name, "node", 4) == 0 && sscanf(entry->d_name + 4, "%d", &node) == 1) {
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
@@ -0,0 +1,41 @@
+/*
+ * @Description  : CPU 绑定与 NUMA 拓扑
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 16:42:10
+ * @Last update  : 2026-10-18 16:42:10
+ */
+
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+
+#include <vector>
+#include <sched.h>
+#include <pthread.h>
+
+/* 进程允许使用的 CPU 列表，按 NUMA 结点排序，依次分配给主循环、子 Reactor 和工作线程，
+ * 线程数较少时都落在同一个结点上。线程绑定后，连接表、HttpConn 和缓冲区内存都由所属线程首次写入，
+ * 按 Linux 的首次访问策略分配在该线程所在的结点；编译时定义 USE_NUMA 则改用 libnuma 显式本地分配 */
+class CpuAffinity {
+public:
+    static CpuAffinity* get_instance();
+
+    /* 第 i 个分配位置对应的 CPU，超出 CPU 数时循环使用 */
+    int cpu(int i) const { return cpus[i % cpus.size()]; }
+    int cpu_count() const { return cpus.size(); }
+    int node_count() const { return nodes; }
+
+    /* 将当前线程绑定到指定 CPU */
+    static bool bind(int cpu);
+    static int node_of(int cpu);
+
+private:
+    CpuAffinity();
+    ~CpuAffinity() = default;
+
+    std::vector<int> cpus;
+    int nodes;
+};
+
+
+#endif
@@ -0,0 +1,380 @@
+/*
+ * @Description  : 子 Reactor（one loop per thread）
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-17 10:12:40
+ * @Last update  : 2026-10-17 10:12:40
+ */
+
+#include "sub_reactor.h"
+#include <algorithm>
+using namespace std;
+
+SubReactor::SubReactor(int id_, int timeout_, uint32_t conn_event_, int io_engine_, int cpu_):
+        id(id_), cpu(cpu_), timeout(timeout_), conn_event(conn_event_ & ~EPOLLONESHOT), listen_event(0),
+        is_close(false), conn_num(0), timer(new Timers()), epoller(new Epoller(1024, io_engine_)), users(MAX_FD)
+{
+    /* 连接固定在本线程内处理，不需要 EPOLLONESHOT 再次注册 */
+    wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert(wakeup_fd >= 0);
+    epoller->add_fd(wakeup_fd, EPOLLIN);
+    completion = epoller->has_completion();
+    send_num = 0;
+}
+
+SubReactor::~SubReactor() {
+    stop();
+    for(int fd : listen_fds) {
+        close(fd);
+    }
+    close(wakeup_fd);
+}
+
+void SubReactor::start() {
+    thread = std::thread(&SubReactor::loop, this);
+}
+
+void SubReactor::stop() {
+    if(is_close.exchange(true)) { return; }
+    wakeup();
+    if(thread.joinable()) { thread.join(); }
+}
+
+void SubReactor::add_conn(int fd, const sockaddr_in& addr) {
+    {
+        lock_guard<mutex> locker(mtx);
+        pending.emplace_back(fd, addr);
+    }
+    conn_num++;
+    wakeup();
+}
+
+void SubReactor::add_listen(int fd, uint32_t listen_event_) {
+    assert(fd > 0 && !thread.joinable());
+    listen_event = listen_event_;
+    listen_fds.push_back(fd);
+    if(!epoller->add_acceptor(fd)) {
+        epoller->add_fd(fd, listen_event | EPOLLIN);
+    }
+    /* 提示内核把在本 CPU 上收到的新连接交给这个分片，网卡队列与 CPU 对应时连接从收包到处理都在同一个 CPU 上 */
+    if(cpu >= 0 && setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) < 0) {
+        LOG_WARN("SubReactor[%d] set SO_INCOMING_CPU error:%d", id, errno);
+    }
+}
+
+void SubReactor::wakeup() {
+    uint64_t one = 1;
+    ssize_t n = ::write(wakeup_fd, &one, sizeof(one));
+    if(n != sizeof(one)) {
+        LOG_WARN("SubReactor[%d] wakeup error!", id);
+    }
+}
+
+/* 接管主 Reactor 分配过来的连接，处理数据库线程返回的结果 */
+void SubReactor::handle_wakeup() {
+    uint64_t cnt = 0;
+    ssize_t n = ::read(wakeup_fd, &cnt, sizeof(cnt));
+    if(n != sizeof(cnt) && errno != EAGAIN) {
+        LOG_WARN("SubReactor[%d] read wakeup error!", id);
+    }
+    vector<pair<int, sockaddr_in>> conns;
+    vector<Verified> results;
+    {
+        lock_guard<mutex> locker(mtx);
+        conns.swap(pending);
+        results.swap(verified);
+    }
+    for(auto& conn : conns) {
+        add_client(conn.first, conn.second);
+    }
+    for(const Verified& result : results) {
+        if(!ConnTable::alive(result.slot, result.gen)) { continue; }
+        result.slot->conn->finish_verify(result.pass);
+        on_process(result.slot, false);
+    }
+}
+
+void SubReactor::loop() {
+    int timeMS = -1;
+    if(cpu >= 0 && !CpuAffinity::bind(cpu)) {
+        LOG_WARN("SubReactor[%d] bind cpu %d error!", id, cpu);
+    }
+    LOG_INFO("SubReactor[%d] start, cpu:%d", id, cpu);
+    while(!is_close) {
+        if(timeout > 0) {
+            timeMS = timer->get_next_tick();
+        }
+        int eventCnt = epoller->wait(timeMS);
+        if(timeout > 0) {
+            timer->update_clock();                      // 本轮事件处理中 add/adjust 使用的时间
+        }
+        for(int i = 0; i < eventCnt; i++) {
+            int fd = epoller->get_event_fd(i);
+            uint32_t events = epoller->get_events(i);
+            int op = epoller->get_op(i);
+            if(fd == wakeup_fd) {
+                handle_wakeup();
+            }
+            else if(std::find(listen_fds.begin(), listen_fds.end(), fd) != listen_fds.end()) {
+                if(op == IO_ACCEPT) { deal_accepted(epoller->get_result(i)); }
+                else { deal_listen(fd); }
+            }
+            else {
+                ConnSlot* slot = users.get(fd);
+                if(!slot) {
+                    LOG_WARN("SubReactor[%d] event on closed client[%d]", id, fd);
+                    continue;
+                }
+                if(op == IO_RECV) {
+                    on_recv(slot, epoller->get_data(i), epoller->get_result(i));
+                }
+                else if(op == IO_SEND) {
+                    on_sent(slot, epoller->get_result(i));
+                }
+                else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    close_conn(slot, slot->gen.load());
+                }
+                else if(events & EPOLLIN) {
+                    extent_time(slot);
+                    on_read(slot);
+                }
+                else if(events & EPOLLOUT) {
+                    extent_time(slot);
+                    on_process(slot, true);
+                } else {
+                    LOG_ERROR("Unexpected event");
+                }
+            }
+        }
+    }
+    /* 退出前关闭本 Reactor 上的所有连接，发送中的连接 shutdown 之后等发送结束再关闭 */
+    users.for_each([this](ConnSlot* slot) { close_conn(slot, slot->gen.load()); });
+    while(send_num > 0) {
+        int eventCnt = epoller->wait(100);
+        if(eventCnt <= 0) { break; }
+        for(int i = 0; i < eventCnt; i++) {
+            ConnSlot* slot = users.get(epoller->get_event_fd(i));
+            if(slot && epoller->get_op(i) == IO_SEND) {
+                on_sent(slot, epoller->get_result(i));
+            }
+        }
+    }
+    LOG_INFO("SubReactor[%d] quit", id);
+}
+
+/* 在本线程内 accept 监听分片上的新连接，不再经过主 Reactor 转交 */
+void SubReactor::deal_listen(int listen_fd) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    do {
+        int fd = accept4(listen_fd, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK);
+        if(fd <= 0) { return; }
+        else if(HttpConn::user_count >= MAX_FD) {
+            send(fd, "Server busy!", 12, 0);
+            close(fd);
+            LOG_WARN("Clients is full!");
+            return;
+        }
+        conn_num++;
+        add_client(fd, addr);
+    } while(listen_event & EPOLLET);
+}
+
+/* multishot accept 的完成事件，fd 为新连接（出错时为 -errno） */
+void SubReactor::deal_accepted(int fd) {
+    if(fd < 0) {
+        LOG_WARN("SubReactor[%d] accept error:%d", id, -fd);
+        return;
+    }
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if(getpeername(fd, (struct sockaddr *)&addr, &len) < 0) {
+        memset(&addr, 0, sizeof(addr));
+    }
+    if(HttpConn::user_count >= MAX_FD) {
+        send(fd, "Server busy!", 12, 0);
+        close(fd);
+        LOG_WARN("Clients is full!");
+        return;
+    }
+    conn_num++;
+    add_client(fd, addr);
+}
+
+void SubReactor::add_client(int fd, const sockaddr_in& addr) {
+    assert(fd > 0);
+    ConnSlot* slot = users.open(fd, addr);
+    if(!slot) {
+        send(fd, "Server busy!", 12, 0);
+        close(fd);
+        conn_num--;
+        LOG_WARN("SubReactor[%d] client fd[%d] out of range!", id, fd);
+        return;
+    }
+    if(timeout > 0) {
+        timer->add(fd, timeout, std::bind(&SubReactor::close_conn, this, slot, slot->gen.load()));
+    }
+    if(completion) {
+        epoller->add_receiver(fd);
+    }
+    else {
+        epoller->add_fd(fd, EPOLLIN | conn_event);
+    }
+    LOG_DEBUG("SubReactor[%d] adopt client[%d]", id, fd);
+}
+
+void SubReactor::close_conn(ConnSlot* slot, uint32_t gen) {
+    assert(slot);
+    /* 内核还在读取写缓冲区，shutdown 让发送尽快结束，在 on_sent 中再关闭 */
+    if(slot->sending) {
+        if(ConnTable::alive(slot, gen) && !slot->closing) {
+            slot->closing = true;
+            shutdown(slot->fd, SHUT_RDWR);
+        }
+        return;
+    }
+    if(!users.release(slot, gen)) {
+        return;
+    }
+    const ConnInfo& info = users.info(slot);
+    LOG_DEBUG("SubReactor[%d] client[%d] requests:%lu, alive:%lds", id, slot->fd,
+              (unsigned long)info.requests, (long)(time(nullptr) - info.open_time));
+    epoller->del_fd(slot->fd);
+    timer->cancel(slot->fd);
+    slot->conn->Close();
+    conn_num--;
+}
+
+void SubReactor::extent_time(ConnSlot* slot) {
+    assert(slot);
+    if(timeout > 0) {
+        timer->adjust(slot->fd, timeout);
+    }
+}
+
+void SubReactor::on_read(ConnSlot* slot) {
+    assert(slot);
+    int read_error = 0;
+    ssize_t ret = slot->conn->read(&read_error);
+    if(ret <= 0 && read_error != EAGAIN) {
+        close_conn(slot, slot->gen.load());
+        return;
+    }
+    on_process(slot, false);
+}
+
+/* 解析请求并在本线程内直接写回响应，只有写缓冲区满时才注册 EPOLLOUT */
+// out_armed 表示当前是否已经注册了 EPOLLOUT
+void SubReactor::on_process(ConnSlot* slot, bool out_armed) {
+    assert(slot);
+    HttpConn* client = slot->conn;
+    int fd = slot->fd;
+    uint32_t gen = slot->gen.load();
+    while(!slot->sending && (client->to_write_bytes() > 0 || client->process())) {
+        /* 交给内核发送，完成后在 on_sent 中继续 */
+        if(completion && start_send(slot)) {
+            return;
+        }
+        int write_error = 0;
+        ssize_t ret = client->write(&write_error);
+        if(client->to_write_bytes() > 0) {
+            if(ret < 0 && write_error != EAGAIN) {
+                close_conn(slot, gen);
+                return;
+            }
+            /* 继续传输 */
+            if(completion) { arm_out(fd); }
+            else if(!out_armed) { epoller->mod_fd(fd, conn_event | EPOLLOUT); }
+            return;
+        }
+        /* 传输完成 */
+        users.info(slot).requests++;
+        if(!client->is_keep_alive()) {
+            close_conn(slot, gen);
+            return;
+        }
+    }
+    if(out_armed && !completion) {
+        epoller->mod_fd(fd, conn_event | EPOLLIN);
+    }
+    if(client->take_verify()) {
+        start_verify(slot, gen);
+    }
+}
+
+/* 内核读到的数据，len <= 0 表示对端关闭或出错 */
+void SubReactor::on_recv(ConnSlot* slot, const char* data, int len) {
+    assert(slot);
+    if(slot->closing) {
+        return;
+    }
+    if(len <= 0) {
+        close_conn(slot, slot->gen.load());
+        return;
+    }
+    extent_time(slot);
+    slot->conn->feed(data, len);
+    on_process(slot, false);
+}
+
+/* 内核发送完成：扣除已发送的数据，继续发送剩余数据或处理读缓冲区中的后续请求 */
+void SubReactor::on_sent(ConnSlot* slot, int len) {
+    assert(slot && slot->sending);
+    HttpConn* client = slot->conn;
+    uint32_t gen = slot->gen.load();
+    slot->sending = false;
+    send_num--;
+    if(slot->closing || len <= 0) {
+        close_conn(slot, gen);
+        return;
+    }
+    client->finish_send(len);
+    extent_time(slot);
+    if(client->to_write_bytes() == 0) {
+        /* 传输完成 */
+        users.info(slot).requests++;
+        if(!client->is_keep_alive()) {
+            close_conn(slot, gen);
+            return;
+        }
+    }
+    on_process(slot, false);
+}
+
+/* 队首响应体需要 sendfile 或提交队列已满时返回 false，由调用方同步写 */
+bool SubReactor::start_send(ConnSlot* slot) {
+    const struct iovec* iov = nullptr;
+    int cnt = slot->conn->send_iov(&iov);
+    if(cnt == 0 || !epoller->send(slot->fd, iov, cnt)) {
+        return false;
+    }
+    slot->sending = true;
+    send_num++;
+    return true;
+}
+
+/* 完成通知模式下连接没有常驻的 poll，sendfile 写满时注册一次性的 EPOLLOUT */
+void SubReactor::arm_out(int fd) {
+    if(!epoller->mod_fd(fd, EPOLLOUT | EPOLLONESHOT)) {
+        epoller->add_fd(fd, EPOLLOUT | EPOLLONESHOT);
+    }
+}
+
+/* 登录/注册先查凭据缓存，未命中时交给数据库线程执行，结果放入队列并唤醒本线程，在本线程内生成响应 */
+void SubReactor::start_verify(ConnSlot* slot, uint32_t gen) {
+    const HttpRequest& request = slot->conn->get_request();
+    string name = request.get_post("username");
+    string pwd = request.get_post("password");
+    bool is_login = request.is_login();
+    bool submitted = HttpRequest::verify_async(name, pwd, is_login, [=](bool pass) {
+        {
+            lock_guard<mutex> locker(mtx);
+            verified.push_back({slot, gen, pass});
+        }
+        wakeup();
+    });
+    if(!submitted) {
+        LOG_WARN("SubReactor[%d] SqlExecutor is busy, client[%d] verify failed!", id, slot->fd);
+        slot->conn->finish_verify(false);
+        on_process(slot, false);
+    }
+}
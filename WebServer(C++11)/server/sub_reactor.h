@@ -0,0 +1,103 @@
+/*
+ * @Description  : 子 Reactor（one loop per thread）
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-17 10:12:40
+ * @Last update  : 2026-10-17 10:12:40
+ */
+
+#ifndef SUB_REACTOR_H
+#define SUB_REACTOR_H
+
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <unistd.h>
+#include <assert.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+
+#include "../epoll/epoller.h"
+#include "../log/log.h"
+#include "../timer/timer.h"
+#include "../http/http_connect.h"
+#include "../pool/sql_executor.h"
+#include "conn_table.h"
+#include "cpu_affinity.h"
+
+/* 每个子 Reactor 独占一个线程、一个 Epoller、一组定时器和连接表，
+ * 连接在其生命周期内只由所属的子 Reactor 处理，读写不再经过线程池；
+ * 引擎支持完成通知（io_uring）时，accept/recv/send 都由内核完成，只有 sendfile 写满时才等待 EPOLLOUT */
+class SubReactor {
+public:
+    SubReactor(int id_, int timeout_, uint32_t conn_event_, int io_engine_, int cpu_ = -1);
+    ~SubReactor();
+
+    void start();
+    void stop();
+
+    /* 由主 Reactor（acceptor）线程调用，将新连接交给本 Reactor */
+    void add_conn(int fd, const sockaddr_in& addr);
+
+    /* 在 start 之前调用，本 Reactor 自己 accept 该 SO_REUSEPORT 监听分片上的连接 */
+    void add_listen(int fd, uint32_t listen_event_);
+
+    int conn_count() const { return conn_num; }
+
+private:
+    void loop();
+    void wakeup();
+    void handle_wakeup();
+
+    void deal_listen(int listen_fd);
+    void deal_accepted(int fd);
+    void add_client(int fd, const sockaddr_in& addr);
+    void close_conn(ConnSlot* slot, uint32_t gen);
+    void extent_time(ConnSlot* slot);
+
+    void on_read(ConnSlot* slot);
+    void on_process(ConnSlot* slot, bool out_armed);
+    void start_verify(ConnSlot* slot, uint32_t gen);
+
+    void on_recv(ConnSlot* slot, const char* data, int len);
+    void on_sent(ConnSlot* slot, int len);
+    bool start_send(ConnSlot* slot);
+    void arm_out(int fd);
+
+    int id;
+    int cpu;                                                    // 绑定的 CPU，-1 表示不绑定
+    int timeout;
+    uint32_t conn_event;
+    int wakeup_fd;                                              // eventfd，用于唤醒阻塞在 epoll_wait 上的线程
+    uint32_t listen_event;
+    std::vector<int> listen_fds;                                // 本 Reactor 负责的监听分片
+    bool completion;                                            // 连接读写使用完成通知
+    int send_num;                                               // 内核中未完成的发送数
+
+    std::atomic<bool> is_close;
+    std::atomic<int> conn_num;                                  // 当前连接数，供最小负载分配使用
+    std::thread thread;
+
+    /* 数据库线程返回的登录/注册结果 */
+    struct Verified {
+        ConnSlot* slot;
+        uint32_t gen;
+        bool pass;
+    };
+
+    std::mutex mtx;                                             // 保护待接管的连接队列和数据库结果队列
+    std::vector<std::pair<int, sockaddr_in>> pending;
+    std::vector<Verified> verified;
+
+    std::unique_ptr<Timers> timer;
+    std::unique_ptr<Epoller> epoller;
+    ConnTable users;
+
+    static const int MAX_FD = 65536;
+};
+
+
+#endif
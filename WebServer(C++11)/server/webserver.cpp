@@ -12,42 +12,91 @@ WebServer::WebServer(
         int port_, int trig_mode_, int timeout_, bool opt_linger_,
         int sql_port_, const char* sql_user_, const  char* sql_pwd_,
         const char* db_name_, int connPool_num_, int thread_num_,
-        bool open_log_, int log_level_, int log_que_size_):
+        int reactor_num_, int dispatch_mode_, int listen_shards_, int backlog_, int io_engine_,
+        int sendfile_threshold_, int file_cache_size_, int buffer_high_water_, int cpu_affinity_,
+        int user_write_mode_, int user_write_flush_ms_, int user_write_batch_,
+        bool open_log_, int log_level_, int log_que_size_, bool log_binary_):
         port(port_), open_linger(opt_linger_), timeout(timeout_), is_close(false),
-        timer(new Timers()), threadpool(new ThreadPool(thread_num_)), epoller(new Epoller())
+        backlog(backlog_), listen_shards(listen_shards_), dispatch_mode(dispatch_mode_), next_reactor(0), cpu_affinity(cpu_affinity_ > 0), timer(new Timers()),
+        threadpool(new ThreadPool(thread_num_, 1024, cpu_affinity_ > 0 ? bind_worker(1 + reactor_num_) : nullptr)), epoller(new Epoller(1024, io_engine_)), users(MAX_FD)
 {
     src_dir = getcwd(nullptr, 256);
     assert(src_dir);
     strncat(src_dir, "/html/", 16);
     HttpConn::user_count = 0;
     HttpConn::src_dir = src_dir;
+    Buffer::high_water = buffer_high_water_ > 0 ? buffer_high_water_ : 0;
+    FileCache::get_instance()->init(file_cache_size_ > 0 ? (size_t)file_cache_size_ << 20 : 0,
+                                    sendfile_threshold_ > 0 ? sendfile_threshold_ : 0, &HttpResponse::get_file_type);
+    threadpool->set_handler(&WebServer::handle_task, this);
     SqlConnPool::get_instance()->init("localhost", sql_port_, sql_user_, sql_pwd_, db_name_, connPool_num_);
+    {
+        /* 数据库线程启动后独占所有连接，过滤器在此之前建立 */
+        MYSQL* sql = nullptr;
+        SqlConnRAII conn(&sql, SqlConnPool::get_instance());
+        UserFilter::get_instance()->init(USER_FILTER_REBUILD_S);
+        UserFilter::get_instance()->build(sql);
+    }
+    SqlExecutor::get_instance()->init(connPool_num_);
+    UserCache::get_instance()->init(USER_CACHE_SIZE, USER_CACHE_TTL_MS, USER_CACHE_NEGATIVE_TTL_MS);
+    if(user_write_mode_ != WRITE_SYNC) {
+        UserWriter::get_instance()->init(user_write_mode_, user_write_flush_ms_ > 0 ? user_write_flush_ms_ : 10,
+                                         user_write_batch_ > 0 ? user_write_batch_ : 256);
+    }
     init_event_mode(trig_mode_);
+    for(int i = 0; i < reactor_num_; i++) {
+        int cpu = cpu_affinity ? CpuAffinity::get_instance()->cpu(1 + i) : -1;
+        reactors.emplace_back(new SubReactor(i, timeout, conn_event, io_engine_, cpu));
+    }
     if(!init_socket()) { is_close = true;}
 
     if(open_log_) {
-        Log::get_instance()->init(log_level_, "./LOG", ".log", log_que_size_);
+        Log::get_instance()->init(log_level_, "./LOG", log_binary_ ? ".blog" : ".log", log_que_size_, log_binary_);
         if(is_close) { LOG_ERROR("========== Server init error!=========="); }
         else {
             LOG_INFO("========== Server init ==========");
             LOG_INFO("Port:%d, OpenLinger: %s", port_, opt_linger_? "true":"false");
+            LOG_INFO("IO engine: %s", epoller->engine_name());
             LOG_INFO("Listen Mode: %s, OpenConn Mode: %s",
                      (listen_event & EPOLLET ? "ET": "LT"),
                      (conn_event & EPOLLET ? "ET": "LT"));
-            LOG_INFO("Log level: %d", log_level_);
+            LOG_INFO("Log level: %d, format: %s", log_level_, (log_binary_ ? "binary" : "text"));
             LOG_INFO("Src dir: %s", HttpConn::src_dir);
+            LOG_INFO("Sendfile threshold: %d, FileCache size: %dMB", sendfile_threshold_, file_cache_size_);
+            LOG_INFO("Buffer high water: %d", buffer_high_water_);
+            LOG_INFO("CPU affinity: %s, cpus:%d, numa nodes:%d", (cpu_affinity ? "on" : "off"),
+                     CpuAffinity::get_instance()->cpu_count(), CpuAffinity::get_instance()->node_count());
             LOG_INFO("SqlConnPool num: %d, ThreadPool num: %d", connPool_num_, thread_num_);
+            LOG_INFO("SubReactor num: %d, Dispatch: %s", reactor_num_,
+                     (dispatch_mode == 1 ? "least-loaded" : "round-robin"));
         }
     }
 }
 
 WebServer::~WebServer() {
-    close(listen_fd);
+    if(listen_fd >= 0) { close(listen_fd); }
     is_close = true;
+    UserWriter::get_instance()->stop();                 // 已登记的注册通过数据库线程写入，在其之前停止
+    SqlExecutor::get_instance()->stop();                // 数据库线程会向线程池和子 Reactor 投递结果，先停止
+    reactors.clear();
+    FileCache::get_instance()->log_stats();
+    UserCache::get_instance()->log_stats();
+    UserFilter::get_instance()->log_stats();
+    UserWriter::get_instance()->log_stats();
+    PoolStats st = threadpool->stats();
+    LOG_INFO("ThreadPool steals:%lu, parks:%lu, queued:%zu, max queued:%zu", (unsigned long)st.steals,
+             (unsigned long)st.parks, st.queued, st.max_queued);
     free(src_dir);
     SqlConnPool::get_instance()->close_pool();
 }
 
+/* 工作线程 i 绑定到第 first + i 个 CPU */
+ThreadInit WebServer::bind_worker(int first) {
+    return [first](size_t i) {
+        CpuAffinity::bind(CpuAffinity::get_instance()->cpu(first + i));
+    };
+}
+
 void WebServer::init_event_mode(int trigMode) {
     listen_event = EPOLLRDHUP;
     conn_event = EPOLLONESHOT | EPOLLRDHUP;
@@ -75,32 +124,48 @@ void WebServer::init_event_mode(int trigMode) {
 
 void WebServer::start() {
     int timeMS = -1;  /* epoll wait timeout == -1 无事件将阻塞 */
+    if(cpu_affinity && !CpuAffinity::bind(CpuAffinity::get_instance()->cpu(0))) {
+        LOG_WARN("Bind main loop cpu error!");
+    }
     if(!is_close) { LOG_INFO("========== Server start =========="); }
+    for(auto& reactor : reactors) {
+        reactor->start();
+    }
     while(!is_close) {
         if(timeout > 0) {
             timeMS = timer->get_next_tick();
         }
         int eventCnt = epoller->wait(timeMS);
+        if(timeout > 0) {
+            timer->update_clock();                      // 本轮事件处理中 add/adjust 使用的时间
+        }
         for(int i = 0; i < eventCnt; i++) {
             /* 处理事件 */
             int fd = epoller->get_event_fd(i);
             uint32_t events = epoller->get_events(i);
             if(fd == listen_fd) {
-                deal_listen();
-            }
-            else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
-                assert(users.count(fd) > 0);
-                close_conn(&users[fd]);
-            }
-            else if(events & EPOLLIN) {
-                assert(users.count(fd) > 0);
-                deal_read(&users[fd]);
+                if(epoller->get_op(i) == IO_ACCEPT) { deal_accepted(epoller->get_result(i)); }
+                else { deal_listen(); }
             }
-            else if(events & EPOLLOUT) {
-                assert(users.count(fd) > 0);
-                deal_write(&users[fd]);
-            } else {
-                LOG_ERROR("Unexpected event");
+            else {
+                ConnSlot* slot = users.get(fd);
+                if(!slot) {
+                    LOG_WARN("Event on closed client[%d]", fd);
+                    continue;
+                }
+                /* EPOLLONESHOT：事件已注销，主线程取得处理权，之后关闭或交给工作线程 */
+                slot->pool_state.fetch_and((uint8_t)~SLOT_ARMED, memory_order_acq_rel);
+                if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                    close_conn(slot, slot->gen.load());
+                }
+                else if(events & EPOLLIN) {
+                    deal_read(slot);
+                }
+                else if(events & EPOLLOUT) {
+                    deal_write(slot);
+                } else {
+                    LOG_ERROR("Unexpected event");
+                }
             }
         }
     }
@@ -115,107 +180,254 @@ void WebServer::send_error(int fd, const char* info) {
     close(fd);
 }
 
-void WebServer::close_conn(HttpConn* client) {
-    assert(client);
-    epoller->del_fd(client->get_fd());
-    client->Close();
+/* 定时器和工作线程可能同时关闭同一连接，只有成功释放槽位的一方执行关闭 */
+void WebServer::close_conn(ConnSlot* slot, uint32_t gen) {
+    assert(slot);
+    if(!users.release(slot, gen)) {
+        return;
+    }
+    const ConnInfo& info = users.info(slot);
+    LOG_DEBUG("Client[%d] requests:%lu, alive:%lds", slot->fd,
+              (unsigned long)info.requests, (long)(time(nullptr) - info.open_time));
+    epoller->del_fd(slot->fd);
+    slot->conn->Close();
+}
+
+/* 定时器回调在主线程执行，而关闭连接会把读写缓冲区的块归还内存池，必须由正在处理该连接的线程完成：
+ * 事件已注册时没有工作线程在处理，直接关闭；否则只做标记，由工作线程在 rearm 时关闭 */
+void WebServer::expire_conn(ConnSlot* slot, uint32_t gen) {
+    assert(slot);
+    if(!ConnTable::alive(slot, gen)) { return; }
+    if(slot->pool_state.fetch_or(SLOT_EXPIRED, memory_order_acq_rel) & SLOT_ARMED) {
+        close_conn(slot, gen);
+    }
+}
+
+/* 工作线程处理完毕后重新注册事件，交出处理权；此后不能再访问连接对象 */
+void WebServer::rearm(ConnSlot* slot, uint32_t events) {
+    if(slot->pool_state.fetch_or(SLOT_ARMED, memory_order_acq_rel) & SLOT_EXPIRED) {
+        close_conn(slot, slot->gen.load());
+        return;
+    }
+    epoller->mod_fd(slot->fd, conn_event | events);
 }
 
 void WebServer::add_client(int fd, sockaddr_in addr) {
     assert(fd > 0);
-    users[fd].init(fd, addr);
+    ConnSlot* slot = users.open(fd, addr);
+    if(!slot) {
+        send_error(fd, "Server busy!");
+        LOG_WARN("Client fd[%d] out of range!", fd);
+        return;
+    }
     if(timeout > 0) {
-        timer->add(fd, timeout, std::bind(&WebServer::close_conn, this, &users[fd]));
+        timer->add(fd, timeout, std::bind(&WebServer::expire_conn, this, slot, slot->gen.load()));
     }
     epoller->add_fd(fd, EPOLLIN | conn_event);
-    set_fd_nonblock(fd);
 }
 
 void WebServer::deal_listen() {
     struct sockaddr_in addr;
     socklen_t len = sizeof(addr);
     do {
-        int fd = accept(listen_fd, (struct sockaddr *)&addr, &len);
+        int fd = accept4(listen_fd, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK);
         if(fd <= 0) { return;}
         else if(HttpConn::user_count >= MAX_FD) {
             send_error(fd, "Server busy!");
             LOG_WARN("Clients is full!");
             return;
         }
-        add_client(fd, addr);
+        if(reactors.empty()) { add_client(fd, addr); }
+        else { dispatch(fd, addr); }
     } while(listen_event & EPOLLET);
 }
 
-void WebServer::deal_read(HttpConn* client) {
-    assert(client);
-    extent_time(client);
-    threadpool->add_task(std::bind(&WebServer::on_read, this, client));
+/* multishot accept 的完成事件：内核已经完成 accept，fd 为新连接（出错时为 -errno，已是非阻塞），对端地址另外获取 */
+void WebServer::deal_accepted(int fd) {
+    if(fd < 0) {
+        LOG_WARN("Accept error:%d", -fd);
+        return;
+    }
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if(getpeername(fd, (struct sockaddr *)&addr, &len) < 0) {
+        memset(&addr, 0, sizeof(addr));
+    }
+    if(HttpConn::user_count >= MAX_FD) {
+        send_error(fd, "Server busy!");
+        LOG_WARN("Clients is full!");
+        return;
+    }
+    if(reactors.empty()) { add_client(fd, addr); }
+    else { dispatch(fd, addr); }
+}
+
+/* 将新连接分配给子 Reactor，连接之后的读写都固定在该 Reactor 线程内 */
+void WebServer::dispatch(int fd, sockaddr_in addr) {
+    assert(fd > 0 && !reactors.empty());
+    size_t idx = next_reactor;
+    if(dispatch_mode == 1) {
+        /* 最小连接数 */
+        for(size_t i = 0; i < reactors.size(); i++) {
+            if(reactors[i]->conn_count() < reactors[idx]->conn_count()) { idx = i; }
+        }
+    }
+    next_reactor = (idx + 1) % reactors.size();
+    reactors[idx]->add_conn(fd, addr);
 }
 
-void WebServer::deal_write(HttpConn* client) {
-    assert(client);
-    extent_time(client);
-    threadpool->add_task(std::bind(&WebServer::on_write, this, client));
+void WebServer::deal_read(ConnSlot* slot) {
+    assert(slot);
+    extent_time(slot);
+    threadpool->post_task(slot, slot->gen.load(), TASK_READ);
 }
 
-void WebServer::extent_time(HttpConn* client) {
-    assert(client);
+void WebServer::deal_write(ConnSlot* slot) {
+    assert(slot);
+    extent_time(slot);
+    threadpool->post_task(slot, slot->gen.load(), TASK_WRITE);
+}
+
+/* 线程池中定长任务的分发函数 */
+void WebServer::handle_task(void* ctx, const PoolTask& task) {
+    WebServer* server = static_cast<WebServer*>(ctx);
+    ConnSlot* slot = static_cast<ConnSlot*>(task.arg);
+    if(task.op == TASK_READ) {
+        server->on_read(slot, task.gen);
+    }
+    else if(task.op == TASK_WRITE) {
+        server->on_write(slot, task.gen);
+    }
+    else {
+        server->on_verified(slot, task.gen, task.op == TASK_VERIFY_PASS);
+    }
+}
+
+void WebServer::extent_time(ConnSlot* slot) {
+    assert(slot);
     if(timeout > 0) {
-        timer->adjust(client->get_fd(), timeout);
+        timer->adjust(slot->fd, timeout);
     }
 }
 
-void WebServer::on_read(HttpConn* client) {
-    assert(client);
+/* 任务执行前连接可能已被关闭或 fd 已被新连接复用，gen 不一致时直接丢弃 */
+void WebServer::on_read(ConnSlot* slot, uint32_t gen) {
+    assert(slot);
+    if(!ConnTable::alive(slot, gen)) { return; }
+    HttpConn* client = slot->conn;
     int ret = -1;
     int read_error = 0;
     ret = client->read(&read_error);
     if(ret <= 0 && read_error != EAGAIN) {
-        close_conn(client);
+        close_conn(slot, gen);
         return;
     }
-    on_process(client);
+    on_process(slot);
 }
 
-void WebServer::on_process(HttpConn* client) {
-    if(client->process()) {
-        epoller->mod_fd(client->get_fd(), conn_event | EPOLLOUT);
+void WebServer::on_process(ConnSlot* slot) {
+    if(slot->conn->process()) {
+        users.info(slot).requests++;
+        rearm(slot, EPOLLOUT);
     } 
+    else if(slot->conn->take_verify()) {
+        start_verify(slot, slot->gen.load());
+    }
     else {
-        epoller->mod_fd(client->get_fd(), conn_event | EPOLLIN);
+        rearm(slot, EPOLLIN);
+    }
+}
+
+/* 登录/注册先查凭据缓存，未命中时交给数据库线程执行，期间不注册任何事件（EPOLLONESHOT），连接不会被其他工作线程处理；
+ * 结果作为任务投递回线程池，在工作线程上生成响应 */
+void WebServer::start_verify(ConnSlot* slot, uint32_t gen) {
+    const HttpRequest& request = slot->conn->get_request();
+    string name = request.get_post("username");
+    string pwd = request.get_post("password");
+    bool is_login = request.is_login();
+    bool submitted = HttpRequest::verify_async(name, pwd, is_login, [=](bool pass) {
+        threadpool->post_task(slot, gen, pass ? TASK_VERIFY_PASS : TASK_VERIFY_FAIL);
+    });
+    if(!submitted) {
+        LOG_WARN("SqlExecutor is busy, client[%d] verify failed!", slot->fd);
+        on_verified(slot, gen, false);
     }
 }
 
-void WebServer::on_write(HttpConn* client) {
-    assert(client);
+void WebServer::on_verified(ConnSlot* slot, uint32_t gen, bool pass) {
+    assert(slot);
+    if(!ConnTable::alive(slot, gen)) { return; }
+    slot->conn->finish_verify(pass);
+    on_process(slot);
+}
+
+void WebServer::on_write(ConnSlot* slot, uint32_t gen) {
+    assert(slot);
+    if(!ConnTable::alive(slot, gen)) { return; }
+    HttpConn* client = slot->conn;
     int ret = -1;
     int write_error = 0;
     ret = client->write(&write_error);
     if(client->to_write_bytes() == 0) {
         /* 传输完成 */
         if(client->is_keep_alive()) {
-            on_process(client);
+            on_process(slot);
             return;
         }
     }
-    else if(ret < 0) {
-        if(write_error == EAGAIN) {
-            /* 继续传输 */
-            epoller->mod_fd(client->get_fd(), conn_event | EPOLLOUT);
-            return;
-        }
+    else if(ret > 0 || write_error == EAGAIN) {
+        /* 继续传输：LT 模式下剩余不足 10240 字节时也会返回 */
+        rearm(slot, EPOLLOUT);
+        return;
     }
-    close_conn(client);
+    close_conn(slot, gen);
 }
 
 /* Create listenFd */
 bool WebServer::init_socket() {
-    int ret;
-    struct sockaddr_in addr;
     if(port > 65535 || port < 1024) {
         LOG_ERROR("Port:%d error!",  port);
         return false;
     }
+
+    if(listen_shards > 0 && reactors.empty()) {
+        LOG_WARN("Listen shards need sub reactors, fall back to single listener!");
+        listen_shards = 0;
+    }
+
+    /* 分片监听：每个分片一个 SO_REUSEPORT 套接字，由内核在分片间均衡新连接，各自在所属子 Reactor 内 accept */
+    if(listen_shards > 0) {
+        listen_fd = -1;
+        for(int i = 0; i < listen_shards; i++) {
+            int fd = create_listen_fd(true);
+            if(fd < 0) {
+                return false;
+            }
+            reactors[i % reactors.size()]->add_listen(fd, listen_event);
+        }
+        LOG_INFO("Server port:%d, listen shards:%d, backlog:%d", port, listen_shards, backlog);
+        return true;
+    }
+
+    listen_fd = create_listen_fd(false);
+    if(listen_fd < 0) {
+        return false;
+    }
+    /* io_uring 引擎下由内核 multishot accept，不支持时注册可读事件 */
+    int ret = epoller->add_acceptor(listen_fd) || epoller->add_fd(listen_fd,  listen_event | EPOLLIN);
+    if(ret == 0) {
+        LOG_ERROR("Add listen error!");
+        close(listen_fd);
+        return false;
+    }
+    LOG_INFO("Server port:%d, backlog:%d", port, backlog);
+    return true;
+}
+
+/* 创建、绑定并监听一个套接字，失败返回 -1 */
+int WebServer::create_listen_fd(bool reuse_port) {
+    int ret;
+    struct sockaddr_in addr;
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = htonl(INADDR_ANY);
     addr.sin_port = htons(port);
@@ -226,51 +438,54 @@ bool WebServer::init_socket() {
         optLinger.l_linger = 1;
     }
 
-    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if(listen_fd < 0) {
-        LOG_ERROR("Create socket error!", port);
-        return false;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0) {
+        LOG_ERROR("Create socket error!");
+        return -1;
     }
 
-    ret = setsockopt(listen_fd, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
+    ret = setsockopt(fd, SOL_SOCKET, SO_LINGER, &optLinger, sizeof(optLinger));
     if(ret < 0) {
-        close(listen_fd);
-        LOG_ERROR("Init linger error!", port);
-        return false;
+        close(fd);
+        LOG_ERROR("Init linger error!");
+        return -1;
     }
 
     int optval = 1;
     /* 端口复用 */
     /* 只有最后一个套接字会正常接收数据。 */
-    ret = setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
+    ret = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, (const void*)&optval, sizeof(int));
     if(ret == -1) {
         LOG_ERROR("set socket setsockopt error !");
-        close(listen_fd);
-        return false;
+        close(fd);
+        return -1;
+    }
+
+    /* 多个套接字绑定同一端口，内核按四元组哈希分配新连接 */
+    if(reuse_port) {
+        ret = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (const void*)&optval, sizeof(int));
+        if(ret == -1) {
+            LOG_ERROR("set SO_REUSEPORT error !");
+            close(fd);
+            return -1;
+        }
     }
 
-    ret = bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+    ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
     if(ret < 0) {
         LOG_ERROR("Bind Port:%d error!", port);
-        close(listen_fd);
-        return false;
+        close(fd);
+        return -1;
     }
 
-    ret = listen(listen_fd, 6);
+    ret = listen(fd, backlog);
     if(ret < 0) {
         LOG_ERROR("Listen port:%d error!", port);
-        close(listen_fd);
-        return false;
+        close(fd);
+        return -1;
     }
-    ret = epoller->add_fd(listen_fd,  listen_event | EPOLLIN);
-    if(ret == 0) {
-        LOG_ERROR("Add listen error!");
-        close(listen_fd);
-        return false;
-    }
-    set_fd_nonblock(listen_fd);
-    LOG_INFO("Server port:%d", port);
-    return true;
+    set_fd_nonblock(fd);
+    return fd;
 }
 
 int WebServer::set_fd_nonblock(int fd) {
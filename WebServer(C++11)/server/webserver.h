@@ -9,7 +9,8 @@
 #define WEBSERVER_H
 
 
-#include <unordered_map>
+#include <vector>
+#include <memory>
 #include <fcntl.h>
 #include <unistd.h>
 #include <assert.h>
@@ -22,8 +23,15 @@
 #include "../log/log.h"
 #include "../timer/timer.h"
 #include "../pool/sql_connection_pool.h"
+#include "../pool/sql_executor.h"
+#include "../pool/user_cache.h"
+#include "../pool/user_filter.h"
+#include "../pool/user_writer.h"
 #include "../pool/thread_pool.h"
 #include "../http/http_connect.h"
+#include "conn_table.h"
+#include "sub_reactor.h"
+#include "cpu_affinity.h"
 
 class WebServer {
 public:
@@ -31,29 +39,47 @@ public:
             int port_, int trig_mode_, int timeout_, bool opt_linger_,
             int sql_port_, const char* sql_user_, const  char* sql_pwd_,
             const char* db_name_, int connPool_num_, int thread_num_,
-            bool open_log_, int log_level_, int log_que_size_);
+            int reactor_num_, int dispatch_mode_, int listen_shards_, int backlog_, int io_engine_,
+            int sendfile_threshold_, int file_cache_size_, int buffer_high_water_, int cpu_affinity_,
+            int user_write_mode_, int user_write_flush_ms_, int user_write_batch_,
+            bool open_log_, int log_level_, int log_que_size_, bool log_binary_);
 
     ~WebServer();
     void start();
 
 private:
     bool init_socket();
+    int create_listen_fd(bool reuse_port);
     void init_event_mode(int trig_mode_);
     void add_client(int fd, sockaddr_in addr);
+    void dispatch(int fd, sockaddr_in addr);
 
     void deal_listen();
-    void deal_write(HttpConn* client);
-    void deal_read(HttpConn* client);
+    void deal_accepted(int fd);
+    void deal_write(ConnSlot* slot);
+    void deal_read(ConnSlot* slot);
 
     void send_error(int fd, const char*info);
-    void extent_time(HttpConn* client);
-    void close_conn(HttpConn* client);
+    void extent_time(ConnSlot* slot);
+    void close_conn(ConnSlot* slot, uint32_t gen);
+    void expire_conn(ConnSlot* slot, uint32_t gen);
+    void rearm(ConnSlot* slot, uint32_t events);
 
-    void on_read(HttpConn* client);
-    void on_write(HttpConn* client);
-    void on_process(HttpConn* client);
+    void on_read(ConnSlot* slot, uint32_t gen);
+    void on_write(ConnSlot* slot, uint32_t gen);
+    void on_process(ConnSlot* slot);
+    void start_verify(ConnSlot* slot, uint32_t gen);
+    void on_verified(ConnSlot* slot, uint32_t gen, bool pass);
+
+    enum CONN_TASK { TASK_READ = 0, TASK_WRITE, TASK_VERIFY_PASS, TASK_VERIFY_FAIL };
+    static void handle_task(void* ctx, const PoolTask& task);
+    static ThreadInit bind_worker(int first);
 
     static const int MAX_FD = 65536;
+    static const size_t USER_CACHE_SIZE = 100000;                      // 凭据缓存条目上限
+    static const int USER_CACHE_TTL_MS = 60000;                         // 存在的用户缓存 60 秒
+    static const int USER_CACHE_NEGATIVE_TTL_MS = 5000;                 // 不存在的用户缓存 5 秒
+    static const int USER_FILTER_REBUILD_S = 3600;                      // 用户名过滤器每小时重建
     static int set_fd_nonblock(int fd);
 
     int port;
@@ -61,15 +87,22 @@ private:
     int timeout;
     bool is_close;
     int listen_fd;
+    int backlog;                                        // 监听队列长度
+    int listen_shards;                                  // SO_REUSEPORT 监听分片数，0 为单个监听套接字
     char* src_dir;
 
     uint32_t listen_event;
     uint32_t conn_event;
 
+    int dispatch_mode;                                  // 新连接分配方式，0：轮询，1：最小连接数
+    size_t next_reactor;
+    bool cpu_affinity;                                  // 是否绑定 CPU：主循环 0 号，子 Reactor 依次其后，再往后是工作线程
+
     std::unique_ptr<Timers> timer;
     std::unique_ptr<ThreadPool> threadpool;
     std::unique_ptr<Epoller> epoller;
-    std::unordered_map<int, HttpConn> users;
+    ConnTable users;
+    std::vector<std::unique_ptr<SubReactor>> reactors;  // 子 Reactor，为空时退化为单 Reactor + 线程池
 };
 
 
@@ -0,0 +1,103 @@
+/*
+ * @Description  : Buffer 微基准（make buffer_bench；./buffer_bench）
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 22:10:37
+ * @Last update  : 2026-10-18 22:10:37
+ */
+
+#include "../buffer/buffer.h"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+using namespace std;
+
+static double elapsed_ns(chrono::steady_clock::time_point start, int ops) {
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / ops;
+}
+
+/* keep-alive 响应循环：写入响应头后取空 */
+static void bench_append(size_t high_water, int ops) {
+    Buffer::high_water = high_water;
+    Buffer buff;
+    string head(300, 'h');
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < ops; i++) {
+        buff.append(head);
+        buff.retrieve_all();
+    }
+    printf("append(300B) + retrieve_all, high_water %6zu: %6.1f ns/op\n", high_water, elapsed_ns(start, ops));
+}
+
+/* 请求读取循环：从套接字读入一个请求后取空 */
+static bool bench_read_fd(int ops) {
+    int fds[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        perror("socketpair");
+        return false;
+    }
+    Buffer::high_water = 0;
+    Buffer buff;
+    string req(400, 'r');
+    int err = 0;
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < ops; i++) {
+        if(write(fds[1], req.data(), req.size()) != (ssize_t)req.size() ||
+           buff.read_fd(fds[0], &err) != (ssize_t)req.size()) {
+            printf("read_fd error:%d\n", err);
+            return false;
+        }
+        buff.retrieve_all();
+    }
+    printf("read_fd(400B) + retrieve_all:                 %6.1f ns/op\n", elapsed_ns(start, ops));
+
+    /* 大 POST 取空归还内存块后，下一次 read_fd 必须重新借用内存块再计算可写长度 */
+    string post(256 << 10, 'p');
+    string next = "GET / HTTP/1.1\r\n\r\n";
+    for(size_t off = 0; off < post.size(); ) {
+        ssize_t n = write(fds[1], post.data() + off, min(post.size() - off, (size_t)32768));
+        if(n <= 0) {
+            return false;
+        }
+        off += n;
+        while(buff.readable_bytes() < off && buff.read_fd(fds[0], &err) > 0) {}
+    }
+    bool ok = buff.readable_bytes() == post.size();
+    buff.retrieve_all();
+    if(write(fds[1], next.data(), next.size()) != (ssize_t)next.size() ||
+       buff.read_fd(fds[0], &err) != (ssize_t)next.size()) {
+        ok = false;
+    }
+    ok = ok && string(buff.read_ptr(), buff.readable_bytes()) == next;
+    printf("read_fd after 256KB POST:                     %s\n", ok ? "ok" : "CORRUPTED");
+    close(fds[0]);
+    close(fds[1]);
+    return ok;
+}
+
+/* 大量连接各收到一次 256KB 的 POST 后空闲，取空后内存块应归还 */
+static void bench_idle(int conns) {
+    Buffer::high_water = 0;
+    vector<unique_ptr<Buffer>> buffs;
+    string post(256 << 10, 'p');
+    for(int i = 0; i < conns; i++) {
+        buffs.emplace_back(new Buffer());
+        buffs.back()->append(post);
+        buffs.back()->retrieve_all();
+    }
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    printf("max RSS, %d buffers idle after 256KB:        %6ld MB\n", conns, ru.ru_maxrss >> 10);
+}
+
+int main() {
+    const int ops = 5000000;
+    bench_append(0, ops);
+    bench_append(65536, ops);
+    bool ok = bench_read_fd(ops / 10);
+    bench_idle(10000);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,362 @@
+/*
+ * @Description  : libmysqlclient 的进程内替身，代替 -lmysqlclient 链接（make standin）
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-19 01:32:47
+ * @Last update  : 2026-10-19 01:32:47
+ */
+
+#include <mysql/mysql.h>
+#include <mysql/mysqld_error.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+using namespace std;
+
+/* 只实现服务器用到的接口：user 表保存在内存中，预处理语句支持按用户名查询密码和插入用户，
+ * mysql_query 只支持 UserFilter 的两条查询；支持事务（关闭自动提交后插入的行在提交时才可见）。
+ * 环境变量：
+ *   STANDIN_DELAY_MS  每次与“服务端”往返（执行语句、查询、提交）的固定延迟，模拟慢数据库
+ *   STANDIN_USERS     启动时预置的用户数，用户名 user<i>，密码 pwd<i>
+ * 句柄由替身自己分配，转换成 MYSQL* 等类型返回，不访问头文件中结构体的成员 */
+
+typedef decltype(mysql_commit(nullptr)) client_bool;                    // MySQL 8.0 为 bool，MariaDB 和旧版本为 my_bool
+
+namespace {
+
+struct Table {
+    mutex mtx;
+    unordered_map<string, string> users;
+
+    Table() {
+        const char* n = getenv("STANDIN_USERS");
+        for(long i = 0, cnt = n ? atol(n) : 0; i < cnt; i++) {
+            users.emplace("user" + to_string(i), "pwd" + to_string(i));
+        }
+    }
+};
+
+Table& table() {
+    static Table t;
+    return t;
+}
+
+void round_trip() {
+    static const int delay = getenv("STANDIN_DELAY_MS") ? atoi(getenv("STANDIN_DELAY_MS")) : 0;
+    if(delay > 0) { usleep(delay * 1000); }
+}
+
+struct Error {
+    unsigned int no = 0;
+    string msg;
+
+    void set(unsigned int no_, const string& msg_) { no = no_; msg = msg_; }
+    void clear() { no = 0; msg.clear(); }
+};
+
+/* 单列结果集 */
+struct Result {
+    vector<string> values;
+    size_t next = 0;
+    char* row[1];
+    unsigned long lens[1];
+};
+
+struct Conn {
+    unsigned long thread_id;
+    bool autocommit = true;
+    unordered_map<string, string> uncommitted;                          // 当前事务插入的行
+    Result* result = nullptr;                                           // mysql_query 之后待取的结果集
+    Error err;
+
+    bool find(const string& name, string& pwd) {
+        auto it = uncommitted.find(name);
+        if(it != uncommitted.end()) {
+            pwd = it->second;
+            return true;
+        }
+        Table& t = table();
+        lock_guard<mutex> locker(t.mtx);
+        auto found = t.users.find(name);
+        if(found == t.users.end()) { return false; }
+        pwd = found->second;
+        return true;
+    }
+
+    bool insert(const string& name, const string& pwd) {
+        string old;
+        if(find(name, old)) {
+            err.set(ER_DUP_ENTRY, "Duplicate entry '" + name + "' for key 'username'");
+            return false;
+        }
+        if(!autocommit) {
+            uncommitted.emplace(name, pwd);
+            return true;
+        }
+        Table& t = table();
+        lock_guard<mutex> locker(t.mtx);
+        if(!t.users.emplace(name, pwd).second) {
+            err.set(ER_DUP_ENTRY, "Duplicate entry '" + name + "' for key 'username'");
+            return false;
+        }
+        return true;
+    }
+
+    void commit() {
+        Table& t = table();
+        lock_guard<mutex> locker(t.mtx);
+        for(auto& row : uncommitted) { t.users.insert(row); }
+        uncommitted.clear();
+    }
+};
+
+enum STMT_KIND { KIND_NONE, KIND_SELECT_PASSWD, KIND_INSERT_USER };
+
+struct Stmt {
+    Conn* conn;
+    STMT_KIND kind = KIND_NONE;
+    MYSQL_BIND* params = nullptr;
+    MYSQL_BIND* results = nullptr;
+    bool has_row = false;
+    string value;
+    unsigned long long affected = 0;
+    Error err;
+};
+
+Conn* conn_of(MYSQL* sql) { return reinterpret_cast<Conn*>(sql); }
+Stmt* stmt_of(MYSQL_STMT* stmt) { return reinterpret_cast<Stmt*>(stmt); }
+Result* res_of(MYSQL_RES* res) { return reinterpret_cast<Result*>(res); }
+
+string param_string(const MYSQL_BIND& bind) {
+    unsigned long len = bind.length ? *bind.length : bind.buffer_length;
+    return string(static_cast<const char*>(bind.buffer), len);
+}
+
+bool starts_with(const char* s, unsigned long len, const char* prefix) {
+    size_t n = strlen(prefix);
+    return len >= n && strncmp(s, prefix, n) == 0;
+}
+
+}
+
+extern "C" {
+
+MYSQL* mysql_init(MYSQL* sql) {
+    static atomic<unsigned long> next_thread_id(1);
+    if(sql) { return nullptr; }                                         // 替身不能在调用方提供的结构体中保存状态
+    Conn* conn = new Conn();
+    conn->thread_id = next_thread_id++;
+    return reinterpret_cast<MYSQL*>(conn);
+}
+
+int mysql_options(MYSQL*, enum mysql_option, const void*) {
+    return 0;
+}
+
+MYSQL* mysql_real_connect(MYSQL* sql, const char*, const char*, const char*, const char*, unsigned int, const char*, unsigned long) {
+    round_trip();
+    return sql;
+}
+
+void mysql_close(MYSQL* sql) {
+    if(!sql) { return; }
+    delete conn_of(sql)->result;
+    delete conn_of(sql);
+}
+
+void mysql_library_end() {}
+
+unsigned long mysql_thread_id(MYSQL* sql) {
+    return conn_of(sql)->thread_id;
+}
+
+int mysql_ping(MYSQL* sql) {
+    round_trip();
+    conn_of(sql)->err.clear();
+    return 0;
+}
+
+unsigned int mysql_errno(MYSQL* sql) {
+    return conn_of(sql)->err.no;
+}
+
+const char* mysql_error(MYSQL* sql) {
+    return conn_of(sql)->err.msg.c_str();
+}
+
+int mysql_query(MYSQL* sql, const char* query) {
+    Conn* conn = conn_of(sql);
+    round_trip();
+    conn->err.clear();
+    delete conn->result;
+    conn->result = nullptr;
+    unsigned long len = strlen(query);
+    bool count = starts_with(query, len, "SELECT COUNT(*) FROM user");
+    if(!count && !starts_with(query, len, "SELECT username FROM user")) {
+        conn->err.set(ER_PARSE_ERROR, string("not supported by the stand-in: ") + query);
+        return 1;
+    }
+    Result* res = new Result();
+    Table& t = table();
+    {
+        lock_guard<mutex> locker(t.mtx);
+        if(count) {
+            res->values.push_back(to_string(t.users.size()));
+        }
+        else {
+            res->values.reserve(t.users.size());
+            for(auto& user : t.users) { res->values.push_back(user.first); }
+        }
+    }
+    conn->result = res;
+    return 0;
+}
+
+MYSQL_RES* mysql_store_result(MYSQL* sql) {
+    Conn* conn = conn_of(sql);
+    MYSQL_RES* res = reinterpret_cast<MYSQL_RES*>(conn->result);
+    conn->result = nullptr;
+    return res;
+}
+
+MYSQL_RES* mysql_use_result(MYSQL* sql) {
+    return mysql_store_result(sql);
+}
+
+MYSQL_ROW mysql_fetch_row(MYSQL_RES* res) {
+    Result* r = res_of(res);
+    if(r->next >= r->values.size()) { return nullptr; }
+    string& value = r->values[r->next++];
+    r->row[0] = &value[0];
+    r->lens[0] = value.size();
+    return r->row;
+}
+
+unsigned long* mysql_fetch_lengths(MYSQL_RES* res) {
+    return res_of(res)->lens;
+}
+
+void mysql_free_result(MYSQL_RES* res) {
+    delete res_of(res);
+}
+
+client_bool mysql_autocommit(MYSQL* sql, client_bool mode) {
+    Conn* conn = conn_of(sql);
+    round_trip();
+    if(mode && !conn->autocommit) { conn->commit(); }                  // 与 MySQL 相同，打开自动提交时提交当前事务
+    conn->autocommit = mode;
+    conn->err.clear();
+    return 0;
+}
+
+client_bool mysql_commit(MYSQL* sql) {
+    round_trip();
+    conn_of(sql)->commit();
+    conn_of(sql)->err.clear();
+    return 0;
+}
+
+client_bool mysql_rollback(MYSQL* sql) {
+    round_trip();
+    conn_of(sql)->uncommitted.clear();
+    conn_of(sql)->err.clear();
+    return 0;
+}
+
+MYSQL_STMT* mysql_stmt_init(MYSQL* sql) {
+    Stmt* stmt = new Stmt();
+    stmt->conn = conn_of(sql);
+    return reinterpret_cast<MYSQL_STMT*>(stmt);
+}
+
+int mysql_stmt_prepare(MYSQL_STMT* handle, const char* query, unsigned long len) {
+    Stmt* stmt = stmt_of(handle);
+    round_trip();
+    if(starts_with(query, len, "SELECT passwd FROM user WHERE username = ?")) {
+        stmt->kind = KIND_SELECT_PASSWD;
+    }
+    else if(starts_with(query, len, "INSERT INTO user(username, passwd) VALUES(?, ?)")) {
+        stmt->kind = KIND_INSERT_USER;
+    }
+    else {
+        stmt->err.set(ER_PARSE_ERROR, "not supported by the stand-in: " + string(query, len));
+        return 1;
+    }
+    return 0;
+}
+
+client_bool mysql_stmt_bind_param(MYSQL_STMT* handle, MYSQL_BIND* params) {
+    stmt_of(handle)->params = params;
+    return 0;
+}
+
+client_bool mysql_stmt_bind_result(MYSQL_STMT* handle, MYSQL_BIND* results) {
+    stmt_of(handle)->results = results;
+    return 0;
+}
+
+/* 语句的错误同时记在连接上，与 libmysqlclient 一样可以用 mysql_errno 取得 */
+int mysql_stmt_execute(MYSQL_STMT* handle) {
+    Stmt* stmt = stmt_of(handle);
+    Conn* conn = stmt->conn;
+    round_trip();
+    stmt->err.clear();
+    conn->err.clear();
+    stmt->has_row = false;
+    stmt->affected = 0;
+    string name = param_string(stmt->params[0]);
+    if(stmt->kind == KIND_SELECT_PASSWD) {
+        stmt->has_row = conn->find(name, stmt->value);
+        return 0;
+    }
+    if(!conn->insert(name, param_string(stmt->params[1]))) {
+        stmt->err = conn->err;
+        return 1;
+    }
+    stmt->affected = 1;
+    return 0;
+}
+
+int mysql_stmt_store_result(MYSQL_STMT*) {
+    return 0;
+}
+
+int mysql_stmt_fetch(MYSQL_STMT* handle) {
+    Stmt* stmt = stmt_of(handle);
+    if(!stmt->has_row || !stmt->results) { return MYSQL_NO_DATA; }
+    stmt->has_row = false;
+    MYSQL_BIND& result = stmt->results[0];
+    unsigned long n = min<unsigned long>(stmt->value.size(), result.buffer_length);
+    memcpy(result.buffer, stmt->value.data(), n);
+    if(result.length) { *result.length = stmt->value.size(); }
+    return n < stmt->value.size() ? MYSQL_DATA_TRUNCATED : 0;
+}
+
+client_bool mysql_stmt_free_result(MYSQL_STMT* handle) {
+    stmt_of(handle)->has_row = false;
+    return 0;
+}
+
+client_bool mysql_stmt_close(MYSQL_STMT* handle) {
+    delete stmt_of(handle);
+    return 0;
+}
+
+decltype(mysql_stmt_affected_rows(nullptr)) mysql_stmt_affected_rows(MYSQL_STMT* handle) {
+    return stmt_of(handle)->affected;
+}
+
+unsigned int mysql_stmt_errno(MYSQL_STMT* handle) {
+    return stmt_of(handle)->err.no;
+}
+
+const char* mysql_stmt_error(MYSQL_STMT* handle) {
+    return stmt_of(handle)->err.msg.c_str();
+}
+
+}
@@ -0,0 +1,157 @@
+/*
+ * @Description  : 登录注册压力驱动：并发登录注册的同时测量静态页面的延迟（make sql_driver；./sql_driver [端口] [客户端数] [GET 延迟上限毫秒]）
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-19 01:58:12
+ * @Last update  : 2026-10-19 01:58:12
+ */
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+using namespace std;
+
+static int port = 9006;
+static atomic<int> wrong(0);
+static atomic<int> sql_requests(0);
+static atomic<long> slowest_sql_us(0);
+
+static long now_us() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* 发送一个请求（每次新建连接），返回响应体长度，出错返回 -1 */
+static long request(const string& method, const string& path, const string& body) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0) { return -1; }
+    struct timeval tv = {10, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    string req = method + " " + path + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n";
+    if(!body.empty()) {
+        req += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " + to_string(body.size()) + "\r\n";
+    }
+    req += "\r\n" + body;
+    if(write(fd, req.data(), req.size()) != (ssize_t)req.size()) {
+        close(fd);
+        return -1;
+    }
+
+    /* 读到响应头结束和 Content-Length 指定的响应体 */
+    string resp;
+    char buf[16384];
+    long need = -1;
+    while(true) {
+        size_t end = resp.find("\r\n\r\n");
+        if(end != string::npos && need < 0) {
+            const char* len = strcasestr(resp.c_str(), "Content-Length:");
+            if(!len || resp.compare(0, 12, "HTTP/1.1 200") != 0) { break; }
+            need = end + 4 + atol(len + 15);
+        }
+        if(need >= 0 && (long)resp.size() >= need) { break; }
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if(n <= 0) { break; }
+        resp.append(buf, n);
+    }
+    close(fd);
+    if(need < 0 || (long)resp.size() < need) { return -1; }
+    return need - (long)(resp.find("\r\n\r\n") + 4);
+}
+
+static long file_size(const string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : -2;
+}
+
+/* 每个客户端：注册新用户，重复注册，正确密码和错误密码各登录一次 */
+static void client(int id, long welcome, long sign_error, long login_error) {
+    string name = "driver" + to_string(getpid()) + "_" + to_string(id);
+    string pwd = "pwd" + to_string(id);
+    struct {
+        const char* path;
+        string body;
+        long expect;
+    } steps[] = {
+        {"/sign.html", "username=" + name + "&password=" + pwd, welcome},
+        {"/sign.html", "username=" + name + "&password=other", sign_error},
+        {"/login.html", "username=" + name + "&password=" + pwd, welcome},
+        {"/login.html", "username=" + name + "&password=wrong", login_error},
+    };
+    for(auto& step : steps) {
+        long start = now_us();
+        long len = request("POST", step.path, step.body);
+        long cost = now_us() - start;
+        long slowest = slowest_sql_us.load();
+        while(cost > slowest && !slowest_sql_us.compare_exchange_weak(slowest, cost)) {}
+        sql_requests++;
+        if(len != step.expect) {
+            printf("%s %s: got %ld bytes, expect %ld\n", step.path, step.body.c_str(), len, step.expect);
+            wrong++;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if(argc > 1) { port = atoi(argv[1]); }
+    int clients = argc > 2 ? atoi(argv[2]) : 40;
+    long max_get_ms = argc > 3 ? atol(argv[3]) : 100;
+
+    /* 按响应体长度区分结果页面 */
+    long welcome = file_size("./html/welcome.html");
+    long sign_error = file_size("./html/sign_error.html");
+    long login_error = file_size("./html/login_error.html");
+    long index = file_size("./html/index.html");
+    if(index < 0) {
+        printf("run in the WebServer(C++11) directory\n");
+        return 2;
+    }
+
+    atomic<bool> done(false);
+    vector<thread> threads;
+    for(int i = 0; i < clients; i++) {
+        threads.emplace_back(client, i, welcome, sign_error, login_error);
+    }
+
+    /* 登录注册进行期间不断请求静态页面，工作线程被数据库阻塞时延迟接近一次查询的耗时 */
+    thread waiter([&] {
+        for(thread& t : threads) { t.join(); }
+        done = true;
+    });
+    int gets = 0, get_errors = 0;
+    long max_get_us = 0, total_get_us = 0;
+    while(!done) {
+        long start = now_us();
+        long len = request("GET", "/", "");
+        long cost = now_us() - start;
+        gets++;
+        total_get_us += cost;
+        max_get_us = max(max_get_us, cost);
+        if(len != index) { get_errors++; }
+    }
+    waiter.join();
+
+    printf("login/sign-up: %d requests, %d wrong pages, slowest %.1f ms\n",
+           sql_requests.load(), wrong.load(), slowest_sql_us.load() / 1000.0);
+    printf("GET / meanwhile: %d requests, %d errors, max %.1f ms, avg %.1f ms\n",
+           gets, get_errors, max_get_us / 1000.0, gets ? total_get_us / 1000.0 / gets : 0.0);
+    bool ok = wrong == 0 && get_errors == 0 && max_get_us <= max_get_ms * 1000;
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
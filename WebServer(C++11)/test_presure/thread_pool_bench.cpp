@@ -0,0 +1,104 @@
+/*
+ * @Description  : 线程池压力测试（make thread_pool_bench；./thread_pool_bench [子线程数] [提交线程数] [任务数]）
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-19 03:12:40
+ * @Last update  : 2026-10-19 03:12:40
+ */
+
+#include "../pool/thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+using namespace std;
+
+/* 任务编号 i 按 i % 1000 分三类：
+ *   0    通用任务（add_task）
+ *   1    定长任务，执行时在子线程中再提交编号 i + 1（gen 为 1），与 WebServer 在工作线程中投递验证结果相同
+ *   其他 定长任务
+ * 编号 i % 1000 == 2 的任务因此执行两次，其余恰好一次。
+ * 每个子线程队列只有 64 个槽位，提交线程快于子线程时会用到共享的溢出队列 */
+enum { OP_PLAIN = 1, OP_RESUBMIT = 2 };
+
+static ThreadPool* pool = nullptr;
+static unique_ptr<atomic<int>[]> runs;
+static unique_ptr<long[]> posted_ns;
+static atomic<long> done(0);
+static atomic<long> max_wait_ns(0);
+
+static long now_ns() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* 记录任务执行次数和从提交到执行的等待时间（子线程再提交的任务不计等待时间） */
+static void record(size_t i, bool resubmitted) {
+    if(!resubmitted) {
+        long wait = now_ns() - posted_ns[i];
+        long slowest = max_wait_ns.load(memory_order_relaxed);
+        while(wait > slowest && !max_wait_ns.compare_exchange_weak(slowest, wait, memory_order_relaxed)) {}
+    }
+    runs[i]++;
+    done++;
+}
+
+static void handle(void*, const PoolTask& task) {
+    size_t i = (size_t)task.arg;
+    record(i, task.gen == 1);
+    if(task.op == OP_RESUBMIT) {
+        pool->post_task((void*)(i + 1), 1, OP_PLAIN);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int workers = argc > 1 ? atoi(argv[1]) : 8;
+    int producers = argc > 2 ? atoi(argv[2]) : 2;
+    long tasks = argc > 3 ? atol(argv[3]) : 2000000;
+    if(workers <= 0 || producers <= 0 || tasks <= 0) {
+        printf("usage: %s [workers] [producers] [tasks]\n", argv[0]);
+        return 2;
+    }
+
+    runs.reset(new atomic<int>[tasks]());
+    posted_ns.reset(new long[tasks]());
+    long expect = tasks;                                                    // 子线程再提交的任务也计入
+    for(long i = 1; i + 1 < tasks; i += 1000) { expect++; }
+    int wrong = 0;
+    PoolStats st;
+    double elapsed = 0;
+    {
+        ThreadPool tp(workers, 64);
+        pool = &tp;
+        tp.set_handler(handle, nullptr);
+        auto start = chrono::steady_clock::now();
+        vector<thread> threads;
+        for(int p = 0; p < producers; p++) {
+            threads.emplace_back([&tp, p, producers, tasks] {
+                for(long i = p; i < tasks; i += producers) {
+                    posted_ns[i] = now_ns();
+                    if(i % 1000 == 0) { tp.add_task([i] { record(i, false); }); }
+                    else { tp.post_task((void*)i, 0, i % 1000 == 1 && i + 1 < tasks ? OP_RESUBMIT : OP_PLAIN); }
+                }
+            });
+        }
+        for(thread& t : threads) { t.join(); }
+        while(done.load() < expect) { usleep(1000); }
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        st = tp.stats();
+        pool = nullptr;
+    }
+
+    for(long i = 0; i < tasks; i++) {
+        if(runs[i].load() != (i % 1000 == 2 ? 2 : 1)) { wrong++; }
+    }
+    printf("workers %d, producers %d: %ld tasks in %.2fs, %.0f ns/task, max wait %.1f ms\n",
+           workers, producers, expect, elapsed, elapsed / expect * 1e9, max_wait_ns.load() / 1e6);
+    printf("steals %lu, parks %lu, max queued %zu, left %zu, wrong %d\n",
+           (unsigned long)st.steals, (unsigned long)st.parks, st.max_queued, st.queued, wrong);
+    usleep(100 * 1000);                                                     // 等待分离的子线程退出
+    printf("%s\n", wrong == 0 && st.queued == 0 ? "ok" : "FAILED");
+    return wrong == 0 && st.queued == 0 ? 0 : 1;
+}
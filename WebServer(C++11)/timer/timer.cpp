@@ -7,118 +7,219 @@
 
 #include "timer.h"
 
-/* 从第 i 个结点开始，向上处理堆 */
-void Timers::sift_up(size_t i) {
-    assert(i >= 0 && i < timer_heap.size());
-    size_t j = (i - 1) / 2;                             // 父结点
-    while(j >= 0) {
-        if(timer_heap[j] < timer_heap[i]) { break; }
-        swap_timer(i, j);
-        i = j;
-        j = (i - 1) / 2;
+Timers::Timers() : current(0), now(0), count(0) {
+    for(int l = 0; l < LEVELS; l++) {
+        bitmap[l] = 0;
+        for(int i = 0; i < SLOTS; i++) {
+            wheel[l][i].prev = wheel[l][i].next = &wheel[l][i];
+        }
     }
+    update_clock();
+    current = now;
 }
 
-/* 从第 i 个结点开始，向下处理堆 */
-bool Timers::sift_down(size_t index, size_t n) {
-    assert(index >= 0 && index < timer_heap.size());
-    assert(n >= 0 && n <= timer_heap.size());
-    size_t i = index;
-    size_t j = i * 2 + 1;
-    while(j < n) {
-        if(j + 1 < n && timer_heap[j + 1] < timer_heap[j]) j++;         // 取左右孩子中最小的那一个
-        if(timer_heap[i] < timer_heap[j]) break;
-        swap_timer(i, j);
-        i = j;
-        j = i * 2 + 1;
-    }
-    return i > index;
+uint64_t Timers::now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
 }
 
-/* 交换两个定时器 */
-void Timers::swap_timer(size_t i, size_t j) {
-    assert(i >= 0 && i < timer_heap.size());
-    assert(j >= 0 && j < timer_heap.size());
-    std::swap(timer_heap[i], timer_heap[j]);
-    // 更新定时器对应的映射
-    timer_map[timer_heap[i].id] = i;
-    timer_map[timer_heap[j].id] = j;
+void Timers::update_clock() {
+    now = now_ms();
 }
 
-/* 添加一个定时器，可能是新增，也可能是已有的定时器 */
-void Timers::add(int id, int timeout, const TimeoutCallBack& cb) {
+/* 获取编号对应的结点，不存在则创建 */
+TimerNode* Timers::node_of(int id) {
     assert(id >= 0);
-    size_t i;
-    if(timer_map.count(id) == 0) {
-        /* 新节点：堆尾插入，调整堆 */
-        i = timer_heap.size();
-        timer_map[id] = i;
-        timer_heap.push_back({id, Clock::now() + MS(timeout), cb});
-        sift_up(i);
+    if(static_cast<size_t>(id) >= nodes.size()) {
+        nodes.resize(std::max(static_cast<size_t>(id) + 1, nodes.size() * 2));
     }
-    else {
-        /* 已有结点：调整堆 */
-        i = timer_map[id];
-        timer_heap[i].expires = Clock::now() + MS(timeout);
-        timer_heap[i].cb = cb;
-        if(!sift_down(i, timer_heap.size())) {
-            sift_up(i);
-        }
+    if(!nodes[id]) {
+        nodes[id].reset(new TimerNode());
+        nodes[id]->id = id;
+        nodes[id]->bucket = -1;
+    }
+    return nodes[id].get();
+}
+
+/* 按超时时间距当前的远近选择层和槽 */
+void Timers::link(TimerNode* node) {
+    uint64_t expires = std::max(node->expires, current + 1);            // 当前槽已处理过，已超时的放入下一个槽
+    uint64_t delta = expires - current;
+    int level = 0;
+    while(level < LEVELS - 1 && delta >= (1ULL << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    if(delta >= (1ULL << (SLOT_BITS * LEVELS))) {
+        expires = current + (1ULL << (SLOT_BITS * LEVELS)) - 1;
     }
+    int slot = (expires >> (SLOT_BITS * level)) & SLOT_MASK;
+
+    TimerLink* head = &wheel[level][slot];
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+    node->bucket = level * SLOTS + slot;
+    node->slotted = node->expires;
+    bitmap[level] |= 1ULL << slot;
 }
 
-/* 删除指定位置的定时器 */
-void Timers::del(size_t index) {
-    assert(!timer_heap.empty() && index >= 0 && index < timer_heap.size());
-    /* 将要删除的结点换到队尾，然后调整堆 */
-    size_t i = index;
-    size_t n = timer_heap.size() - 1;
-    assert(i <= n);
-    if(i < n) {
-        swap_timer(i, n);
-        if(!sift_down(i, n)) {
-            sift_up(i);
+void Timers::unlink(TimerNode* node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    if(node->bucket >= 0) {
+        int level = node->bucket / SLOTS, slot = node->bucket % SLOTS;
+        if(wheel[level][slot].next == &wheel[level][slot]) {
+            bitmap[level] &= ~(1ULL << slot);
         }
     }
-    /* 队尾元素删除 */
-    timer_map.erase(timer_heap.back().id);
-    timer_heap.pop_back();
+    node->bucket = -1;
 }
 
-/* 调整指定 id 的定时器 */
+/* 添加一个定时器，可能是新增，也可能是已有的定时器 */
+void Timers::add(int id, int timeout, const TimeoutCallBack& cb) {
+    TimerNode* node = node_of(id);
+    node->cb = cb;
+    if(node->bucket == -1) {
+        count++;
+        node->expires = now + timeout;
+        link(node);
+    }
+    else {
+        adjust(id, timeout);
+    }
+}
+
+/* 调整指定 id 的定时器，延后时只修改超时时间 */
 void Timers::adjust(int id, int timeout) {
-    assert(!timer_heap.empty() && timer_map.count(id) > 0);
-    timer_heap[timer_map[id]].expires = Clock::now() + MS(timeout);;
-    sift_down(timer_map[id], timer_heap.size());
+    assert(id >= 0 && static_cast<size_t>(id) < nodes.size() && nodes[id] && nodes[id]->bucket != -1);
+    TimerNode* node = nodes[id].get();
+    node->expires = now + timeout;
+    if(node->expires < node->slotted && node->bucket != DETACHED) {
+        unlink(node);
+        link(node);
+    }
 }
 
-/* 清除超时的定时器 */
-void Timers::tick() {
-    if(timer_heap.empty()) {
+/* 删除指定 id 的定时器，不触发回调 */
+void Timers::cancel(int id) {
+    if(id < 0 || static_cast<size_t>(id) >= nodes.size() || !nodes[id] || nodes[id]->bucket == -1) {
+        return;
+    }
+    unlink(nodes[id].get());
+    nodes[id]->cb = nullptr;
+    count--;
+}
+
+/* 将高层的一个槽重新分配到低层 */
+void Timers::cascade(int level) {
+    int slot = (current >> (SLOT_BITS * level)) & SLOT_MASK;
+    TimerLink* head = &wheel[level][slot];
+    if(head->next != head) {
+        TimerLink list = *head;
+        list.next->prev = list.prev->next = &list;
+        head->prev = head->next = head;
+        bitmap[level] &= ~(1ULL << slot);
+
+        while(list.next != &list) {
+            TimerNode* node = static_cast<TimerNode*>(list.next);
+            node->bucket = DETACHED;
+            unlink(node);
+            link(node);
+        }
+    }
+    /* 本层也转过了一圈，继续从上一层分配 */
+    if(slot == 0 && level + 1 < LEVELS) {
+        cascade(level + 1);
+    }
+}
+
+/* 处理最低层的一个槽：超时的回调，被延期的重新放入 */
+void Timers::expire(int slot) {
+    TimerLink* head = &wheel[0][slot];
+    if(head->next == head) {
         return;
     }
-    while(!timer_heap.empty()) {
-        TimerNode node = timer_heap.front();
-        if(std::chrono::duration_cast<MS>(node.expires - Clock::now()).count() > 0) {
+    TimerLink list = *head;
+    list.next->prev = list.prev->next = &list;
+    head->prev = head->next = head;
+    bitmap[0] &= ~(1ULL << slot);
+    for(TimerLink* p = list.next; p != &list; p = p->next) {
+        static_cast<TimerNode*>(p)->bucket = DETACHED;                 // 回调中可能取消或延期同一槽中的其他定时器
+    }
+
+    while(list.next != &list) {
+        TimerNode* node = static_cast<TimerNode*>(list.next);
+        unlink(node);
+        if(node->expires > current) {
+            link(node);
+            continue;
+        }
+        count--;
+        TimeoutCallBack cb;
+        cb.swap(node->cb);                              // 回调中可能重新添加同一 id 的定时器
+        cb();
+    }
+}
+
+/* 推进时间轮到当前时间，跳过空槽 */
+void Timers::tick() {
+    update_clock();
+    while(current < now) {
+        if(count == 0) {
+            current = now;
+            break;
+        }
+        /* 下一个非空槽或下一次进位，两者中较早的 */
+        uint64_t idx = current & SLOT_MASK;
+        uint64_t bits = idx == SLOT_MASK ? 0 : bitmap[0] & (~0ULL << (idx + 1));
+        uint64_t next = bits ? (current & ~SLOT_MASK) + __builtin_ctzll(bits) : (current | SLOT_MASK) + 1;
+        if(next > now) {
+            current = now;
             break;
         }
-        node.cb();
-        del(0);
+        current = next;
+        if((current & SLOT_MASK) == 0) {
+            cascade(1);
+        }
+        expire(current & SLOT_MASK);
     }
 }
 
 void Timers::clear() {
-    timer_heap.clear();
-    timer_map.clear();
+    for(auto& node : nodes) {
+        if(node && node->bucket != -1) {
+            unlink(node.get());
+            node->cb = nullptr;
+        }
+    }
+    count = 0;
+}
+
+/* 各层中最早需要处理的槽对应的时间；高层的槽按进位（分配到低层）的时间计算 */
+uint64_t Timers::next_expires() const {
+    uint64_t next = UINT64_MAX;
+    for(int l = 0; l < LEVELS; l++) {
+        if(!bitmap[l]) {
+            continue;
+        }
+        int shift = SLOT_BITS * l;
+        uint64_t base = current >> shift;
+        int from = (base + 1) & SLOT_MASK;
+        uint64_t rot = (bitmap[l] >> from) | (from ? bitmap[l] << (SLOTS - from) : 0);
+        uint64_t t = (base + 1 + __builtin_ctzll(rot)) << shift;
+        next = std::min(next, t);
+    }
+    return next;
 }
 
 /* 计算下一个即将超时的定时器还需多长时间超时 */
 int Timers::get_next_tick() {
     tick();
-    size_t res = -1;
-    if(!timer_heap.empty()) {
-        res = std::chrono::duration_cast<MS>(timer_heap.front().expires - Clock::now()).count();
-        if(res < 0) { res = 0; }
+    if(count == 0) {
+        return -1;
     }
-    return res;
-}
\ No newline at end of file
+    uint64_t next = next_expires();
+    return next > now ? static_cast<int>(std::min<uint64_t>(next - now, INT32_MAX)) : 0;
+}
@@ -9,50 +9,75 @@
 #define TIMER_H
 
 
-#include <queue>
-#include <unordered_map>
+#include <vector>
+#include <memory>
 #include <time.h>
 #include <algorithm>
 #include <arpa/inet.h>
 #include <functional>
 #include <assert.h>
-#include <chrono>
+#include <stdint.h>
 #include "../log/log.h"
 
 typedef std::function<void()> TimeoutCallBack;
-typedef std::chrono::high_resolution_clock Clock;
-typedef std::chrono::milliseconds MS;
-typedef Clock::time_point TimeStamp;
+
+/* 双向循环链表结点，时间轮的每个槽以一个哨兵结点作为链表头 */
+struct TimerLink {
+    TimerLink* prev;
+    TimerLink* next;
+};
 
 /* 定义定时器 */
-struct TimerNode {
+struct TimerNode : TimerLink {
     int id;                                                             // 定时器编号
-    TimeStamp expires;                                                  // 超时时间
+    int bucket;                                                         // 所在槽的编号，-1：未启用，DETACHED：正在到期处理
+    uint64_t expires;                                                   // 超时时间（毫秒）
+    uint64_t slotted;                                                   // 放入槽时使用的超时时间
     TimeoutCallBack cb;                                                 // 回调函数
-    bool operator<(const TimerNode& t) {                                // 重载比较符号
-        return expires < t.expires;
-    }
 };
 
+/* 分层时间轮：4 层，每层 64 个槽，精度 1 毫秒，可表示约 4.6 小时内的超时，更远的超时放入最高层最后一个槽。
+ * 定时器按编号（文件描述符）直接索引，添加、删除都是 O(1)；
+ * 延长超时时间时只修改 expires，不移动结点，到槽时发现尚未超时再重新放入（惰性延期）。
+ * 时间使用 CLOCK_MONOTONIC_COARSE，在 get_next_tick() 和 update_clock() 中读取并缓存，
+ * 事件循环每次 wait 返回后调用 update_clock()，同一轮中的 add/adjust 都使用缓存的时间 */
 class Timers {
 public:
-    Timers() { timer_heap.reserve(64); }
+    Timers();
     ~Timers() { clear(); }
 
     void adjust(int id, int new_expires);
     void add(int id, int timeout, const TimeoutCallBack& cb);
+    void cancel(int id);
     void clear();
     void tick();
     int get_next_tick();
+    void update_clock();
+
+    size_t size() const { return count; }
 
 private:
-    void del(size_t i);
-    void sift_up(size_t i);
-    bool sift_down(size_t index, size_t n);
-    void swap_timer(size_t i, size_t j);
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const uint64_t SLOT_MASK = SLOTS - 1;
+    static const int DETACHED = -2;
+
+    static uint64_t now_ms();
+
+    TimerNode* node_of(int id);
+    void link(TimerNode* node);
+    void unlink(TimerNode* node);
+    void cascade(int level);
+    void expire(int bucket);
+    uint64_t next_expires() const;
 
-    std::vector<TimerNode> timer_heap;
-    std::unordered_map<int, size_t> timer_map;
+    TimerLink wheel[LEVELS][SLOTS];
+    uint64_t bitmap[LEVELS];                                            // 非空槽的位图
+    uint64_t current;                                                   // 时间轮已经推进到的时间
+    uint64_t now;                                                       // 缓存的当前时间
+    size_t count;                                                       // 启用的定时器个数
+    std::vector<std::unique_ptr<TimerNode>> nodes;                      // 按编号索引，结点地址不随扩容改变
 };
 
 
@@ -0,0 +1,189 @@
+/*
+ * @Description  : 二进制日志解码工具（make decoder；./log_decoder LOG/2026_10_18.blog ...）
+ * @Author       : Qinghe Li
+ * @Create time  : 2026-10-18 20:40:03
+ * @Last update  : 2026-10-18 20:40:03
+ */
+
+#include "../log/log_binary.h"
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+#include <string>
+using namespace std;
+using namespace LogBinary;
+
+static const char* const TITLES[] = {"[debug]: ", "[info] : ", "[warn] : ", "[error]: "};
+
+struct Arg {
+    uint8_t tag;
+    int64_t i;
+    uint64_t u;
+    double f;
+    string s;
+};
+
+/* 按一个转换说明输出一个参数，stars 为 '*' 给出的宽度和精度 */
+template<typename T>
+static void append(string& out, const string& spec, const vector<int>& stars, T value) {
+    char buf[4096];
+    int n;
+    if(stars.empty()) { n = snprintf(buf, sizeof(buf), spec.c_str(), value); }
+    else if(stars.size() == 1) { n = snprintf(buf, sizeof(buf), spec.c_str(), stars[0], value); }
+    else { n = snprintf(buf, sizeof(buf), spec.c_str(), stars[0], stars[1], value); }
+    if(n > 0) { out.append(buf, min(static_cast<size_t>(n), sizeof(buf) - 1)); }
+}
+
+/* 用记录中的参数还原格式字符串；长度修饰按参数的实际类型重新生成，参数缺失时输出 <?> */
+static void format_event(string& out, const char* format, const vector<Arg>& args) {
+    const char* p = format;
+    const char* last = format;
+    size_t next = 0;
+    Spec spec;
+    while(next_spec(p, spec)) {
+        out.append(last, spec.begin);
+        last = spec.end;
+        if(spec.conv == '%') {
+            out += '%';
+            continue;
+        }
+        vector<int> stars;
+        for(int i = 0; i < spec.stars; i++) {
+            stars.push_back(next < args.size() ? static_cast<int>(args[next++].i) : 0);
+        }
+        if(next >= args.size()) {
+            out += "<?>";
+            continue;
+        }
+        const Arg& arg = args[next++];
+        string base(spec.begin, spec.end - (spec.conv ? 1 : 0));
+        while(!base.empty() && strchr("hlLqjzt", base.back())) { base.pop_back(); }
+        char conv = spec.conv;
+        bool int_conv = conv && strchr("diouxX", conv);
+        bool float_conv = conv && strchr("eEfFgGaA", conv);
+
+        switch(arg.tag) {
+        case ARG_INT:
+        case ARG_UINT:
+            if(conv == 'c') { append(out, base + "c", stars, static_cast<int>(arg.i)); }
+            else if(float_conv) { append(out, base + conv, stars, static_cast<double>(arg.i)); }
+            else if(arg.tag == ARG_INT) { append(out, base + "ll" + (int_conv ? conv : 'd'), stars, static_cast<long long>(arg.i)); }
+            else { append(out, base + "ll" + (int_conv ? conv : 'u'), stars, static_cast<unsigned long long>(arg.u)); }
+            break;
+        case ARG_DOUBLE:
+            if(int_conv) { append(out, base + "lld", stars, static_cast<long long>(arg.f)); }
+            else { append(out, base + (float_conv ? conv : 'f'), stars, arg.f); }
+            break;
+        case ARG_STR:
+            if(conv == 's') { append(out, base + "s", stars, arg.s.c_str()); }
+            else { out += arg.s; }
+            break;
+        case ARG_PTR:
+            append(out, base + "p", stars, reinterpret_cast<void*>(static_cast<uintptr_t>(arg.u)));
+            break;
+        }
+    }
+    out.append(last);
+}
+
+/* 解析 EVENT 记录中的参数，遇到不完整的参数时停止 */
+static void parse_args(const char* p, const char* end, vector<Arg>& args) {
+    args.clear();
+    while(p < end) {
+        Arg arg;
+        arg.tag = static_cast<uint8_t>(*p++);
+        if(arg.tag == ARG_STR) {
+            uint16_t n;
+            if(end - p < 2) { return; }
+            memcpy(&n, p, 2);
+            p += 2;
+            if(end - p < n) { return; }
+            arg.s.assign(p, n);
+            p += n;
+        }
+        else {
+            if(end - p < 8) { return; }
+            memcpy(&arg.u, p, 8);
+            memcpy(&arg.i, p, 8);
+            memcpy(&arg.f, p, 8);
+            p += 8;
+        }
+        args.push_back(arg);
+    }
+}
+
+static bool decode_file(const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if(!fp) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return false;
+    }
+    char magic[sizeof(MAGIC)];
+    if(fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        fprintf(stderr, "%s: not a binary log\n", path);
+        fclose(fp);
+        return false;
+    }
+
+    vector<pair<int, string>> formats;                                  // 下标为格式编号
+    vector<Arg> args;
+    string line;
+    char record[65536];
+    bool ok = true;
+    while(true) {
+        if(fread(record, 1, HEADER_LEN, fp) != HEADER_LEN) { break; }
+        uint16_t len;
+        memcpy(&len, record, 2);
+        if(len < HEADER_LEN || fread(record + HEADER_LEN, 1, len - HEADER_LEN, fp) != len - HEADER_LEN) {
+            fprintf(stderr, "%s: truncated record\n", path);
+            ok = false;
+            break;
+        }
+
+        uint32_t id;
+        if(record[2] == FORMAT && len >= HEADER_LEN + 5) {
+            memcpy(&id, record + HEADER_LEN, 4);
+            if(formats.size() <= id) { formats.resize(id + 1); }
+            formats[id].first = record[HEADER_LEN + 4];
+            formats[id].second.assign(record + HEADER_LEN + 5, len - HEADER_LEN - 5);
+        }
+        else if(record[2] == EVENT && len >= EVENT_HEADER_LEN) {
+            uint64_t usec;
+            memcpy(&id, record + HEADER_LEN, 4);
+            memcpy(&usec, record + HEADER_LEN + 4, 8);
+            parse_args(record + EVENT_HEADER_LEN, record + len, args);
+
+            time_t sec = static_cast<time_t>(usec / 1000000);
+            struct tm t;
+            localtime_r(&sec, &t);
+            char prefix[64];
+            snprintf(prefix, sizeof(prefix), "%04d-%02d-%02d %02d:%02d:%02d.%06d ", t.tm_year + 1900, t.tm_mon + 1,
+                     t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, static_cast<int>(usec % 1000000));
+            line = prefix;
+            if(id < formats.size() && !formats[id].second.empty()) {
+                int level = formats[id].first;
+                line += TITLES[level < 0 ? 0 : (level > 3 ? 3 : level)];
+                format_event(line, formats[id].second.c_str(), args);
+            }
+            else {
+                line += "<unknown format " + to_string(id) + ">";
+            }
+            line += '\n';
+            fwrite(line.data(), 1, line.size(), stdout);
+        }
+    }
+    fclose(fp);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s LOG_FILE...\n", argv[0]);
+        return 1;
+    }
+    int ret = 0;
+    for(int i = 1; i < argc; i++) {
+        if(!decode_file(argv[i])) { ret = 1; }
+    }
+    return ret;
+}
@@ -2,7 +2,7 @@
 
 Config::Config() {
     PORT = 9006;                                // 端口号,默认 9006
-    LOG_WRITE = 0;                              // 日志写入方式，默认同步
+    LOG_WRITE = 0;                              // 日志写入方式，默认同步；1 异步，队列满时丢弃；2 异步，队列满时阻塞
     TRIG_MODE = 0;                              // 触发组合模式,默认 listenfd LT + connfd LT=
     LISTEN_TRIG_MODE = 0;                       // listenfd 触发模式，默认 LT
     CONN_TRIG_MODE = 0;                         // connfd 触发模式，默认LT
@@ -11,11 +11,13 @@ Config::Config() {
     THREAD_NUM = 8;                             // 线程池内的线程数量,默认8
     CLOSE_LOG = 0;                              // 关闭日志,默认不关闭
     ACTOR_MODEL = 0;                            // 并发模型,默认是 proactor
+    CPU_AFFINITY = 0;                           // 绑定 CPU，默认不绑定
+    LOG_BINARY = 0;                             // 二进制日志，默认文本
 }
 
 void Config::parse_arg(int argc, char*argv[]) {
     int opt;
-    const char *str = "p:l:m:o:s:t:c:a:";
+    const char *str = "p:l:m:o:s:t:c:a:b:g:";
     while ((opt = getopt(argc, argv, str)) != -1) {
         switch (opt) {
             case 'p':
@@ -42,6 +44,12 @@ void Config::parse_arg(int argc, char*argv[]) {
             case 'a':
                 ACTOR_MODEL = atoi(optarg);
                 break;
+            case 'b':
+                CPU_AFFINITY = atoi(optarg);
+                break;
+            case 'g':
+                LOG_BINARY = atoi(optarg);
+                break;
             default:
                 break;
         }
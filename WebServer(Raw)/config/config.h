@@ -17,6 +17,8 @@ public:
     int THREAD_NUM;                 // 线程池内的线程数量
     int CLOSE_LOG;                  // 是否关闭日志
     int ACTOR_MODEL;                // 并发模型选择
+    int CPU_AFFINITY;               // 是否绑定 CPU
+    int LOG_BINARY;                 // 是否使用二进制日志
 
     Config();
     ~Config() {};
@@ -17,8 +17,7 @@ const char *error_404_form = "The requested file was not found on this webserver
 const char *error_500_title = "Internal Error";
 const char *error_500_form = "There was an unusual problem serving the request file.\n";
 
-Locker m_lock;
-map<string, string> users;
+UserTable users;                                    // 分片的用户表，登录注册并发读写
 
 // 对文件描述符设置非阻塞
 int set_nonblocking(int fd) {
@@ -90,7 +89,7 @@ void HttpConn::init(int sockfd, const sockaddr_in &addr, char *root, int trig_mo
 
 // 初始化新接受的连接, check_state 默认为分析请求行状态
 void HttpConn::init() {
-    mysql = NULL;
+    conn_pool = NULL;
     bytes_to_send = 0;
     bytes_have_send = 0;
     m_check_state = CHECK_STATE_REQUESTLINE;
@@ -125,29 +124,8 @@ void HttpConn::close_conn(bool real_close) {
 }
 
 void HttpConn::init_mysql_result(ConnectionPool *connPool) {
-    // 先从连接池中取一个连接
-    MYSQL *mysql = NULL;
-    ConnectionRAII mysql_conn(&mysql, connPool);
-
-    // 在 user 表中检索 username，passwd 数据，浏览器端输入
-    if (mysql_query(mysql, "SELECT username,passwd FROM user"))
-        LOG_ERROR("SELECT error:%s\n", mysql_error(mysql));
-
-    // 从表中检索完整的结果集
-    MYSQL_RES *result = mysql_store_result(mysql);
-
-    // 返回结果集中的列数
-    int num_fields = mysql_num_fields(result);
-
-    // 返回所有字段结构的数组
-    MYSQL_FIELD *fields = mysql_fetch_fields(result);
-
-    // 从结果集中获取下一行，将对应的用户名和密码，存入 map 中
-    while(MYSQL_ROW row = mysql_fetch_row(result)) {
-        string temp1(row[0]);
-        string temp2(row[1]);
-        users[temp1] = temp2;
-    }
+    // 连接池中的每个连接各读取 user 表的一部分，并行加载到分片的用户表中
+    users.load(connPool, connPool->get_free_conn(), connPool->m_close_log);
 }
 
 void HttpConn::unmap() {
@@ -336,26 +314,27 @@ HttpConn::HTTP_CODE HttpConn::do_request() {
         password[j] = '\0';
 
         if (*(p + 1) == '3') {
-            // 如果是注册，先检测数据库中是否有重名的, 没有重名的，进行增加数据
-            char *sql_insert = (char *)malloc(sizeof(char) * 200);
-            strcpy(sql_insert, "INSERT INTO user(username, passwd) VALUES(");
-            strcat(sql_insert, "'");
-            strcat(sql_insert, name);
-            strcat(sql_insert, "', '");
-            strcat(sql_insert, password);
-            strcat(sql_insert, "')");
-
-            // 判断 map 中能否找到重复的用户名
-            if (users.find(name) == users.end()) {
-                m_lock.lock();
-                int res = mysql_query(mysql, sql_insert);
-                users.insert(pair<string, string>(name, password));
-                m_lock.unlock();
-
-                if (!res)
+            // 如果是注册，先在用户表中占用该用户名，同名的并发注册只有一个成功，再写入数据库
+            if (users.insert(name, password)) {
+                // 用连接缓存的预处理语句插入，用户名和密码按二进制参数发送，无需拼接和转义
+                MYSQL_BIND params[2];
+                unsigned long lens[2] = {strlen(name), strlen(password)};
+                memset(params, 0, sizeof(params));
+                params[0].buffer_type = MYSQL_TYPE_STRING;
+                params[0].buffer = name;
+                params[0].length = &lens[0];
+                params[1].buffer_type = MYSQL_TYPE_STRING;
+                params[1].buffer = password;
+                params[1].length = &lens[1];
+
+                LazyConnection conn(conn_pool);
+                StmtCache *stmts = conn.stmts();
+                if (stmts != NULL && stmts->execute(STMT_INSERT_USER, params) == 1)
                     strcpy(m_url, "/login.html");
-                else
+                else {
+                    users.erase(name);                  // 写入失败，释放用户名
                     strcpy(m_url, "/sign.html");
+                }
             }
             else
                 strcpy(m_url, "/sign_error.html");
@@ -363,7 +342,7 @@ HttpConn::HTTP_CODE HttpConn::do_request() {
             // 如果是登录，直接判断
             // 若浏览器端输入的用户名和密码在表中可以查找到，返回1，否则返回0
         else if (*(p + 1) == '2') {
-            if (users.find(name) != users.end() && users[name] == password)
+            if (users.verify(name, password))
                 strcpy(m_url, "/welcome.html");
             else
                 strcpy(m_url, "/login_error.html");
@@ -28,7 +28,8 @@
 
 #include "../lock/locker.h"
 #include "../sql/sql_connection_pool.h"
-#include "../timer/lst_timer.h"
+#include "../sql/user_table.h"
+#include "../timer/heap_timer.h"
 #include "../log/log.h"
 
 class HttpConn {
@@ -53,7 +54,7 @@ public:
     int timer_flag;
     int improv;
 
-    MYSQL *mysql;
+    ConnectionPool *conn_pool;                      // 由工作线程设置，登录注册时按需取连接
 
 private:
     int m_sockfd;
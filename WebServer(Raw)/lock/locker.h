@@ -48,6 +48,25 @@ public:
     pthread_mutex_t *get() { return &m_mutex; }
 };
 
+// 读写锁，读多写少的数据使用
+class RwLocker {
+private:
+    pthread_rwlock_t m_rwlock;
+
+public:
+    RwLocker() { if(pthread_rwlock_init(&m_rwlock, NULL)) throw std::exception(); }
+
+    ~RwLocker() { pthread_rwlock_destroy(&m_rwlock); }
+
+    // 共享加锁，多个读者可同时持有
+    bool rdlock() { return pthread_rwlock_rdlock(&m_rwlock) == 0; }
+
+    // 独占加锁
+    bool wrlock() { return pthread_rwlock_wrlock(&m_rwlock) == 0; }
+
+    bool unlock() { return pthread_rwlock_unlock(&m_rwlock) == 0; }
+};
+
 class Cond {
 private:
     pthread_cond_t m_cond;
@@ -2,155 +2,355 @@
 #include <time.h>
 #include <sys/time.h>
 #include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/stat.h>
 #include "log.h"
 #include <pthread.h>
 using namespace std;
 
 Log::Log() {
     m_count = 0;
+    m_fd = -1;
+    m_buf = NULL;
+    m_log_ring = NULL;
     m_is_async = false;
+    m_block_on_full = false;
+    m_sleeping = false;
+    m_stop = false;
+    m_dropped = 0;
+    m_reported = 0;
+    m_binary = false;
+    m_written_formats = 0;
 }
 
-Log::~Log() { if (m_fp != NULL) fclose(m_fp); }
+Log::~Log() {
+    // 通知写线程把队列中剩余的日志写完后退出
+    if (m_is_async) {
+        m_stop = true;
+        m_mutex.lock();
+        m_cond.signal();
+        m_mutex.unlock();
+        pthread_join(m_tid, NULL);
+        delete m_log_ring;
+    }
+    if (m_fd >= 0) close(m_fd);
+    delete [] m_buf;
+}
 
 // 异步需要设置阻塞队列的长度，同步不需要设置
-bool Log::init(const char *file_name, int close_log, int log_buf_size, int split_lines, int max_queue_size) {
-    // 如果设置了 max_queue_size, 则设置为异步
-    if (max_queue_size >= 1) {
-        // 设置写入方式 flag
-        m_is_async = true;
-
-        // 创建并设置阻塞队列长度
-        m_log_queue = new BlockQueue<string>(max_queue_size);
-        pthread_t tid;
-
-        // flush_log_thread 为回调函数, 这里表示创建线程异步写日志
-        pthread_create(&tid, NULL, flush_log_thread, NULL);
-    }
-    
+bool Log::init(const char *file_name, int close_log, int log_buf_size, int split_lines, int max_queue_size, bool block_on_full, bool binary) {
     m_close_log = close_log;
+    m_binary = binary;
     // 设置日志缓冲区相关参数
     m_log_buf_size = log_buf_size;
-    m_buf = new char[m_log_buf_size];
-    memset(m_buf, '\0', m_log_buf_size);
     m_split_lines = split_lines;
+    m_block_on_full = block_on_full;
 
     time_t t = time(NULL);
-    struct tm *sys_tm = localtime(&t);
-    struct tm my_tm = *sys_tm;
+    struct tm my_tm;
+    localtime_r(&t, &my_tm);
 
     // 从后往前找到第一个 / 的位置
     const char *p = strrchr(file_name, '/');
     char log_full_name[256] = {0};
 
     // 若输入的文件名没有 / ，则直接将时间+文件名作为日志名
-    if (p == NULL)
-        snprintf(log_full_name, 255, "%d_%02d_%02d_%s", my_tm.tm_year + 1900, my_tm.tm_mon + 1, my_tm.tm_mday, file_name);
+    if (p == NULL) {
+        dir_name[0] = '\0';
+        snprintf(log_name, 128, "%s", file_name);
+    }
     else {
-        strcpy(log_name, p + 1);                                           // 将 / 之后的内容复制到 log_name 中
-        strncpy(dir_name, file_name, p - file_name + 1);                    // p - file_name + 1 是文件所在路径文件夹的长度, dirname相当于./
-        snprintf(log_full_name, 255, "%s%d_%02d_%02d_%s", dir_name, my_tm.tm_year + 1900, my_tm.tm_mon + 1, my_tm.tm_mday, log_name);           // 后面的参数跟 format 有关
+        snprintf(log_name, 128, "%s", p + 1);                                           // 将 / 之后的内容复制到 log_name 中
+        snprintf(dir_name, 128, "%.*s", (int)(p - file_name + 1), file_name);           // 文件所在路径文件夹, dirname相当于./
     }
+    snprintf(log_full_name, 255, "%s%d_%02d_%02d_%s", dir_name, my_tm.tm_year + 1900, my_tm.tm_mon + 1, my_tm.tm_mday, log_name);
 
     m_today = my_tm.tm_mday;
-    
-    m_fp = fopen(log_full_name, "a");
-    if (m_fp == NULL)
+
+    if (!open_file(log_full_name))
         return false;
 
+    // 如果设置了 max_queue_size, 则设置为异步，记录直接在环形队列的槽中格式化
+    if (max_queue_size >= 1) {
+        m_is_async = true;
+        m_log_ring = new LogRing(max_queue_size, m_log_buf_size);
+
+        // flush_log_thread 为回调函数, 这里表示创建线程异步写日志
+        pthread_create(&m_tid, NULL, flush_log_thread, NULL);
+    }
+    else {
+        m_buf = new char[m_log_buf_size];
+    }
+
     return true;
 }
 
-// 写日志函数
-void Log::write_log(int level, const char *format, ...) {
+// 按 "时间 级别 内容\n" 的格式写入 buf，超长的内容被截断，返回总长度
+int Log::format_line(char *buf, int size, int level, const char *format, va_list valst) {
     // 获取时间
     struct timeval now = {0, 0};
     gettimeofday(&now, NULL);
-    time_t t = now.tv_sec;
-    struct tm *sys_tm = localtime(&t);
-    struct tm my_tm = *sys_tm;
-    char s[16] = {0};
+    struct tm my_tm;
+    localtime_r(&now.tv_sec, &my_tm);
+    const char *s;
 
     // 日志分级
     switch (level) {
     case 0:
-        strcpy(s, "[DEBUG]:");
-        break;
-    case 1:
-        strcpy(s, "[INFO]:");
+        s = "[DEBUG]:";
         break;
     case 2:
-        strcpy(s, "[WARN]:");
+        s = "[WARN]:";
         break;
     case 3:
-        strcpy(s, "[ERROR]:");
+        s = "[ERROR]:";
         break;
     default:
-        strcpy(s, "[INFO]:");
+        s = "[INFO]:";
         break;
     }
 
-    m_mutex.lock();
-    m_count++;                  // 更新现有行数
+    // 写入内容格式：时间 + 内容; 时间格式化，snprintf 成功返回写字符的总数，其中不包括结尾的 null 字符
+    int n = snprintf(buf, 48, "%d-%02d-%02d %02d:%02d:%02d.%06ld %s ",
+                     my_tm.tm_year + 1900, my_tm.tm_mon + 1, my_tm.tm_mday,
+                     my_tm.tm_hour, my_tm.tm_min, my_tm.tm_sec, now.tv_usec, s);
+
+    // 内容格式化，保留一个字节给换行符
+    int m = vsnprintf(buf + n, size - n, format, valst);
+    if (m < 0) m = 0;
+    if (m > size - n - 1) m = size - n - 1;
+    buf[n + m] = '\n';
+    return n + m + 1;
+}
 
-    if (m_today != my_tm.tm_mday || m_count % m_split_lines == 0) {
+// 写入前检查是否需要换文件：跨天则创建当天的日志，行数达到上限则创建带序号的日志
+// 返回当前文件还能写入的行数（不超过 lines）
+int Log::rotate(int lines) {
+    time_t t = time(NULL);
+    struct tm my_tm;
+    localtime_r(&t, &my_tm);
+
+    if (m_today != my_tm.tm_mday || (m_count > 0 && m_count % m_split_lines == 0)) {
         char new_log[256] = {0};
-        fflush(m_fp);
-        fclose(m_fp);
         char tail[16] = {0};
 
         // 格式化日志名中的时间部分
         snprintf(tail, 16, "%d_%02d_%02d_", my_tm.tm_year + 1900, my_tm.tm_mon + 1, my_tm.tm_mday);
-       
+
         if (m_today != my_tm.tm_mday) {
             // 如果是时间不是今天,则创建今天的日志，更新 m_today 和 m_count
             snprintf(new_log, 255, "%s%s%s", dir_name, tail, log_name);
             m_today = my_tm.tm_mday;
             m_count = 0;
         }
-        else{
+        else {
             snprintf(new_log, 255, "%s%s%s.%lld", dir_name, tail, log_name, m_count / m_split_lines);
         }
-        m_fp = fopen(new_log, "a");
+
+        // 新文件打不开时继续写旧文件
+        open_file(new_log);
     }
- 
-    m_mutex.unlock();
 
-    va_list valst;
-    va_start(valst, format);                // 将传入的 format 参数赋值给 valst，便于格式化输出
+    long long left = m_split_lines - m_count % m_split_lines;
+    return lines < left ? lines : (int)left;
+}
 
-    string log_str;
-    m_mutex.lock();
+// 打开日志文件替换当前文件；二进制模式下新文件先写入 MAGIC，并重新写入全部格式
+bool Log::open_file(const char *name) {
+    int fd = open(name, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+    if (m_fd >= 0)
+        close(m_fd);
+    m_fd = fd;
 
-    // 写入内容格式：时间 + 内容; 时间格式化，snprintf 成功返回写字符的总数，其中不包括结尾的 null 字符
-    int n = snprintf(m_buf, 48, "%d-%02d-%02d %02d:%02d:%02d.%06ld %s ",
-                     my_tm.tm_year + 1900, my_tm.tm_mon + 1, my_tm.tm_mday,
-                     my_tm.tm_hour, my_tm.tm_min, my_tm.tm_sec, now.tv_usec, s);
+    // 追加到已有文件时，新的格式记录会覆盖同编号的旧定义
+    m_written_formats = 0;
+    struct stat st;
+    if (m_binary && fstat(m_fd, &st) == 0 && st.st_size == 0) {
+        struct iovec iov = {(void *)LogBinary::MAGIC, sizeof(LogBinary::MAGIC)};
+        write_file(&iov, 1);
+    }
+    return true;
+}
 
-    // 内容格式化，用于向字符串中打印数据、数据格式用户自定义，返回写入到字符数组 str 中的字符个数(不包含终止符)
-    int m = vsnprintf(m_buf + n, m_log_buf_size - 1, format, valst);
-    m_buf[n + m] = '\n';
-    m_buf[n + m + 1] = '\0';
-    log_str = m_buf;
+// 把上次之后新登记的格式写入当前文件，保证文件中每个编号都在第一次使用前定义
+void Log::write_formats() {
+    m_formats_mutex.lock();
+    vector<pair<int, const char *> > list(m_formats.begin() + m_written_formats, m_formats.end());
+    m_formats_mutex.unlock();
+    if (list.empty())
+        return;
 
-    m_mutex.unlock();
+    string records;
+    for (size_t i = 0; i < list.size(); i++) {
+        uint32_t id = (uint32_t)(m_written_formats + i);
+        size_t flen = min(strlen(list[i].second), (size_t)m_log_buf_size);
+        uint16_t len = (uint16_t)(LogBinary::HEADER_LEN + 5 + flen);
+        char head[LogBinary::HEADER_LEN + 5];
+        memcpy(head, &len, 2);
+        head[2] = LogBinary::FORMAT;
+        memcpy(head + 3, &id, 4);
+        head[7] = (char)list[i].first;
+        records.append(head, sizeof(head));
+        records.append(list[i].second, flen);
+    }
+    m_written_formats += list.size();
+    struct iovec iov = {&records[0], records.size()};
+    write_file(&iov, 1);
+}
 
-    // 若 m_is_async 为 true 表示异步，默认为同步
-    // 若异步,则将日志信息加入阻塞队列,同步则加锁向文件中写
-    if (m_is_async && !m_log_queue->full())
-        m_log_queue->push(log_str);
-    else {
+uint32_t Log::register_format(int level, const char *format) {
+    m_formats_mutex.lock();
+    m_formats.push_back(make_pair(level, format));
+    uint32_t id = (uint32_t)(m_formats.size() - 1);
+    m_formats_mutex.unlock();
+    return id;
+}
+
+// 记下以 "%.*s" 输出的字符串参数，编码时按前一个整数参数截取，不要求字符串以 0 结尾
+LogBinary::Format::Format(int level_, const char *format_) : level(level_), format(format_), bounded(0) {
+    const char *p = format;
+    Spec spec;
+    int index = 0;
+    while (next_spec(p, spec)) {
+        if (spec.conv == '%')
+            continue;
+        index += spec.stars;
+        if (spec.conv == 's' && spec.star_precision && index < 64)
+            bounded |= 1ULL << index;
+        index++;
+    }
+    id = Log::get_instance()->register_format(level, format);
+}
+
+// 一次 writev 写入多条记录，短写时继续写剩余部分，出错时丢弃
+void Log::write_file(struct iovec *iov, int cnt) {
+    while (cnt > 0) {
+        ssize_t n = writev(m_fd, iov, cnt);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        while (cnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+// 写线程：取出队列中连续的记录合并写入，队列为空时休眠，最长 FLUSH_INTERVAL_MS
+void Log::async_write_log() {
+    struct iovec iov[MAX_IOV];
+    while (true) {
+        int n = m_log_ring->peek(iov, MAX_IOV);
+        if (n > 0) {
+            // 一批记录跨过行数上限时分两个文件写
+            for (int done = 0; done < n; ) {
+                int cnt = rotate(n - done);
+                if (m_binary)
+                    write_formats();
+                write_file(iov + done, cnt);
+                m_count += cnt;
+                done += cnt;
+            }
+            m_log_ring->release(n);
+            continue;
+        }
+
+        // 丢弃模式下队列已有空位，补记一条丢弃的行数
+        unsigned long dropped = m_dropped.load(memory_order_relaxed);
+        if (dropped != m_reported) {
+            if (m_binary) {
+                static const LogBinary::Format format(2, "Log queue full, dropped %lu lines");
+                write_binary(format, dropped - m_reported);
+            }
+            else {
+                write_log(2, "Log queue full, dropped %lu lines", dropped - m_reported);
+            }
+            m_reported = dropped;
+            continue;
+        }
+        if (m_stop)
+            break;
+
+        m_mutex.lock();
+        m_sleeping = true;
+        if (m_log_ring->size() == 0 && !m_stop) {
+            struct timespec t;
+            clock_gettime(CLOCK_REALTIME, &t);
+            t.tv_nsec += FLUSH_INTERVAL_MS * 1000000L;
+            t.tv_sec += t.tv_nsec / 1000000000L;
+            t.tv_nsec %= 1000000000L;
+            m_cond.time_wait(m_mutex.get(), t);
+        }
+        m_sleeping = false;
+        m_mutex.unlock();
+    }
+}
+
+char *Log::claim(size_t &pos) {
+    if (!m_is_async) {
         m_mutex.lock();
-        fputs(log_str.c_str(), m_fp);
+        return m_buf;
+    }
+
+    // 异步：队列满时按配置阻塞等待或丢弃
+    char *buf = m_log_ring->claim(pos);
+    while (buf == NULL && m_block_on_full) {
+        flush();
+        sched_yield();
+        buf = m_log_ring->claim(pos);
+    }
+    if (buf == NULL)
+        m_dropped.fetch_add(1, memory_order_relaxed);
+    return buf;
+}
+
+void Log::commit(size_t pos, int len, int level) {
+    if (m_is_async) {
+        m_log_ring->commit(pos, len);
+        if (level >= 3 || m_log_ring->size() > m_log_ring->capacity() / 2)
+            flush();
+    }
+    else {
+        // 同步：直接写文件，不经过 stdio 缓冲
+        struct iovec iov = {m_buf, (size_t)len};
+        rotate(1);
+        if (m_binary)
+            write_formats();
+        write_file(&iov, 1);
+        m_count++;
         m_mutex.unlock();
     }
+}
+
+// 写日志函数：在领取到的缓冲区内直接格式化
+void Log::write_log(int level, const char *format, ...) {
+    size_t pos = 0;
+    char *buf = claim(pos);
+    if (buf == NULL)
+        return;
 
+    va_list valst;
+    va_start(valst, format);                // 将传入的 format 参数赋值给 valst，便于格式化输出
+    commit(pos, format_line(buf, m_log_buf_size, level, format, valst), level);
     va_end(valst);
 }
 
+// 写线程休眠时将其唤醒；同步模式每行已直接写入文件，无需刷新
 void Log::flush(void) {
-    m_mutex.lock();
-    // 强制刷新写入流缓冲区
-    fflush(m_fp);
-    m_mutex.unlock();
+    if (m_is_async && m_sleeping.load()) {
+        m_mutex.lock();
+        m_cond.signal();
+        m_mutex.unlock();
+    }
 }
@@ -6,7 +6,12 @@
 #include <string>
 #include <stdarg.h>
 #include <pthread.h>
-#include "block_queue.h"
+#include <atomic>
+#include <vector>
+#include <sys/time.h>
+#include "log_ring.h"
+#include "log_binary.h"
+#include "../lock/locker.h"
 
 using namespace std;
 
@@ -15,16 +20,30 @@ private:
     char dir_name[128];                             // 路径名
     char log_name[128];                             // log 文件名
     int m_split_lines;                              // 日志最大行数
-    int m_log_buf_size;                             // 日志缓冲区大小
+    int m_log_buf_size;                             // 日志缓冲区大小，也是异步模式下每条记录的最大长度
     long long m_count;                              // 日志行数记录
     int m_today;                                    // 因为按天分类,记录当前时间是那一天
-    FILE *m_fp;                                     // 打开 log 的文件指针
-    char *m_buf;                                    // 日志缓冲区
-    BlockQueue<string> *m_log_queue;                // 阻塞队列
+    int m_fd;                                       // 打开 log 的文件描述符
+    char *m_buf;                                    // 同步模式的日志缓冲区
+    LogRing *m_log_ring;                            // 异步模式的无锁环形队列
 
     bool m_is_async;                                // 是否同步标志位
-    Locker m_mutex;
+    bool m_block_on_full;                           // 队列满时阻塞等待还是丢弃
+    Locker m_mutex;                                 // 同步模式写文件、异步模式写线程休眠用
+    Cond m_cond;
+    atomic<bool> m_sleeping;                        // 写线程正在等待
+    atomic<bool> m_stop;
+    atomic<unsigned long> m_dropped;                // 队列满被丢弃的行数
+    unsigned long m_reported;                       // 已写入日志的丢弃行数
+    pthread_t m_tid;
     int m_close_log;                                // 关闭日志
+    bool m_binary;                                  // 二进制模式：记录只保存格式编号和原始参数
+    Locker m_formats_mutex;                         // 保护格式表
+    vector<pair<int, const char *> > m_formats;     // 下标为格式编号
+    size_t m_written_formats;                       // 当前文件已写入的格式记录数
+
+    static const int MAX_IOV = 64;                  // 写线程每次 writev 的最大记录数
+    static const int FLUSH_INTERVAL_MS = 100;       // 写线程空闲时的最长休眠时间
 
 public:
     // C++11 以后, 使用局部变量懒汉不用加锁
@@ -36,37 +55,73 @@ public:
     // 异步写日志公有方法，调用私有方法 async_write_log
     static void *flush_log_thread(void *args) {
         Log::get_instance()->async_write_log();
+        return NULL;
     }
 
-    // 可选择的参数有日志文件、日志缓冲区大小、最大行数以及最长日志条队列
-    bool init(const char *file_name, int close_log, int log_buf_size = 8192, int split_lines = 5000000, int max_queue_size = 0);
+    // 可选择的参数有日志文件、日志缓冲区大小、最大行数以及最长日志条队列；block_on_full 为队列满时的处理方式；binary 为二进制模式
+    bool init(const char *file_name, int close_log, int log_buf_size = 8192, int split_lines = 5000000, int max_queue_size = 0, bool block_on_full = false, bool binary = false);
 
     // 将输出内容按照标准格式整理
     void write_log(int level, const char *format, ...);
 
-    // 强制刷新缓冲区
+    // 二进制模式：不格式化，按类型把参数编码为一条 EVENT 记录
+    template<typename... Args>
+    void write_binary(const LogBinary::Format &format, const Args &... args) {
+        size_t pos = 0;
+        char *buf = claim(pos);
+        if (buf == NULL) return;
+        struct timeval now = {0, 0};
+        gettimeofday(&now, NULL);
+        LogBinary::Encoder encoder(buf, m_log_buf_size);
+        encoder.begin(format.id, (uint64_t)now.tv_sec * 1000000 + now.tv_usec);
+        int expand[] = {0, (encoder.put(args, format.bounded), 0)...};
+        (void)expand;
+        commit(pos, encoder.finish(), format.level);
+    }
+
+    // 登记一个调用点的格式，返回格式编号
+    uint32_t register_format(int level, const char *format);
+
+    // 唤醒写线程立即写入，不等待
     void flush(void);
 
+    unsigned long dropped() const { return m_dropped.load(memory_order_relaxed); }
+
+    bool is_binary() const { return m_binary; }
+
 private:
     Log();
     virtual ~Log();
 
     // 异步写日志方法
-    void *async_write_log() {
-        string single_log;
-        // 从阻塞队列中取出一个日志 string，写入文件
-        while (m_log_queue->pop(single_log)) {
-            m_mutex.lock();
-            fputs(single_log.c_str(), m_fp);
-            m_mutex.unlock();
-        }
-    };
+    void async_write_log();
+
+    // 领取一条记录的缓冲区：异步模式为环形队列的槽，队列满且丢弃时返回 NULL；同步模式加锁后返回 m_buf
+    char *claim(size_t &pos);
+    // 提交 claim 领取的记录
+    void commit(size_t pos, int len, int level);
+
+    int format_line(char *buf, int size, int level, const char *format, va_list valst);
+    void write_file(struct iovec *iov, int cnt);
+    void write_formats();
+    bool open_file(const char *name);
+    int rotate(int lines);
 };
 
+// 二进制模式下每个调用点用一个静态的格式对象，第一次执行时登记编号
+#define LOG_BASE(level, format, ...) if(0 == m_close_log) { \
+        Log *log = Log::get_instance(); \
+        if (log->is_binary()) { \
+            static const LogBinary::Format log_format(level, format); \
+            log->write_binary(log_format, ##__VA_ARGS__); \
+        } \
+        else { log->write_log(level, format, ##__VA_ARGS__); } \
+    }
+
 // 不同类型的日志输出的宏定义
-#define LOG_DEBUG(format, ...) if(0 == m_close_log) { Log::get_instance()->write_log(0, format, ##__VA_ARGS__); Log::get_instance()->flush(); }
-#define LOG_INFO(format, ...) if(0 == m_close_log) { Log::get_instance()->write_log(1, format, ##__VA_ARGS__); Log::get_instance()->flush(); }
-#define LOG_WARN(format, ...) if(0 == m_close_log) { Log::get_instance()->write_log(2, format, ##__VA_ARGS__); Log::get_instance()->flush(); }
-#define LOG_ERROR(format, ...) if(0 == m_close_log) { Log::get_instance()->write_log(3, format, ##__VA_ARGS__); Log::get_instance()->flush(); }
+#define LOG_DEBUG(format, ...) LOG_BASE(0, format, ##__VA_ARGS__)
+#define LOG_INFO(format, ...) LOG_BASE(1, format, ##__VA_ARGS__)
+#define LOG_WARN(format, ...) LOG_BASE(2, format, ##__VA_ARGS__)
+#define LOG_ERROR(format, ...) LOG_BASE(3, format, ##__VA_ARGS__)
 
 #endif
@@ -0,0 +1,172 @@
+/*************************************************************
+* 二进制日志记录格式，与 C++11 版本的 tools/log_decoder 兼容
+* 文件以 MAGIC 开头，之后是连续的记录，所有整数按本机字节序：
+*   记录头    : uint16 总长度 | uint8 类型
+*   FORMAT    : uint32 格式编号 | uint8 级别 | 格式字符串（不含结尾 0）
+*   EVENT     : uint32 格式编号 | uint64 时间戳（微秒） | 参数...
+*   参数      : uint8 类型标记 | 数据（整数、指针、浮点数 8 字节，字符串 uint16 长度 + 内容）
+* 每个文件在使用某个格式编号之前都会先写入对应的 FORMAT 记录，文件可以单独解码
+**************************************************************/
+
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+#include <string>
+#include <algorithm>
+#include <type_traits>
+#include <string.h>
+#include <stdint.h>
+
+using namespace std;
+
+namespace LogBinary {
+
+static const char MAGIC[8] = {'W', 'S', 'B', 'L', 'O', 'G', '0', '1'};
+
+enum RecordType : uint8_t { FORMAT = 1, EVENT = 2 };
+enum ArgTag : uint8_t { ARG_INT = 'i', ARG_UINT = 'u', ARG_DOUBLE = 'f', ARG_STR = 's', ARG_PTR = 'p' };
+
+static const size_t HEADER_LEN = 3;
+static const size_t EVENT_HEADER_LEN = HEADER_LEN + 4 + 8;
+static const size_t MAX_RECORD_LEN = 65535;
+
+// printf 格式中的一个转换说明
+struct Spec {
+    const char *begin;                      // 指向 '%'
+    const char *end;                        // 指向转换字符之后
+    int stars;                              // 宽度和精度中 '*' 的个数，各占用一个参数
+    bool star_precision;                    // 精度为 '*'
+    char conv;                              // 转换字符，'%%' 时为 '%'
+};
+
+// 从 p 开始找下一个转换说明，没有时返回 false
+inline bool next_spec(const char *&p, Spec &spec) {
+    while (*p && *p != '%') p++;
+    if (!*p) return false;
+    spec.begin = p++;
+    spec.stars = 0;
+    spec.star_precision = false;
+    while (*p && strchr("-+ #0'", *p)) p++;
+    if (*p == '*') {
+        spec.stars++;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9') p++;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec.stars++;
+            spec.star_precision = true;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') p++;
+    }
+    while (*p && strchr("hlLqjzt", *p)) p++;
+    spec.conv = *p;
+    if (*p) p++;
+    spec.end = p;
+    return true;
+}
+
+// 调用点的格式信息，第一次执行到该调用点时登记并得到编号
+struct Format {
+    Format(int level_, const char *format_);
+
+    uint32_t id;
+    int level;
+    const char *format;
+    uint64_t bounded;                       // 第 i 位为 1：第 i 个参数是以 "%.*s" 输出的字符串，长度由前一个参数给出
+};
+
+// 把一条 EVENT 记录编码到调用方的缓冲区，超出容量的参数被丢弃
+class Encoder {
+public:
+    Encoder(char *buf, size_t cap) : m_buf(buf), m_cap(min(cap, MAX_RECORD_LEN)), m_len(EVENT_HEADER_LEN), m_index(0), m_last_int(-1) {}
+
+    void begin(uint32_t id, uint64_t usec) {
+        m_buf[2] = EVENT;
+        memcpy(m_buf + HEADER_LEN, &id, 4);
+        memcpy(m_buf + HEADER_LEN + 4, &usec, 8);
+    }
+
+    int finish() {
+        uint16_t n = (uint16_t)m_len;
+        memcpy(m_buf, &n, 2);
+        return (int)m_len;
+    }
+
+    template<typename T>
+    void put(const T &value, uint64_t bounded) {
+        put_arg(value, (bounded >> m_index) & 1);
+        m_index++;
+    }
+
+private:
+    template<typename T>
+    typename enable_if<is_integral<T>::value || is_enum<T>::value>::type
+    put_arg(T value, bool) {
+        if (is_signed<T>::value || is_enum<T>::value) {
+            int64_t v = (int64_t)value;
+            m_last_int = v;
+            put_raw(ARG_INT, &v, 8);
+        }
+        else {
+            uint64_t v = (uint64_t)value;
+            m_last_int = (int64_t)v;
+            put_raw(ARG_UINT, &v, 8);
+        }
+    }
+
+    template<typename T>
+    typename enable_if<is_floating_point<T>::value>::type
+    put_arg(T value, bool) {
+        double v = value;
+        put_raw(ARG_DOUBLE, &v, 8);
+    }
+
+    void put_arg(const char *s, bool bounded) {
+        if (!s) {
+            s = "(null)";
+            bounded = false;
+        }
+        size_t n = bounded ? strnlen(s, m_last_int > 0 ? (size_t)m_last_int : 0) : strlen(s);
+        put_str(s, n);
+    }
+
+    void put_arg(char *s, bool bounded) { put_arg((const char *)s, bounded); }
+    void put_arg(const string &s, bool) { put_str(s.data(), s.size()); }
+
+    template<typename T>
+    void put_arg(T *p, bool) {
+        uint64_t v = (uintptr_t)p;
+        put_raw(ARG_PTR, &v, 8);
+    }
+
+    void put_raw(uint8_t tag, const void *data, size_t n) {
+        if (m_len + 1 + n > m_cap) return;
+        m_buf[m_len++] = tag;
+        memcpy(m_buf + m_len, data, n);
+        m_len += n;
+    }
+
+    // 超长的字符串被截断
+    void put_str(const char *s, size_t n) {
+        if (m_len + 3 > m_cap) return;
+        n = min(n, m_cap - m_len - 3);
+        uint16_t n16 = (uint16_t)n;
+        m_buf[m_len++] = ARG_STR;
+        memcpy(m_buf + m_len, &n16, 2);
+        memcpy(m_buf + m_len + 2, s, n);
+        m_len += 2 + n;
+    }
+
+    char *m_buf;
+    size_t m_cap;
+    size_t m_len;
+    int m_index;
+    int64_t m_last_int;                     // 最近一个整数参数，作为 "%.*s" 的长度
+};
+
+}
+
+#endif
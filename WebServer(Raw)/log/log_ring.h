@@ -0,0 +1,108 @@
+/*************************************************************
+* 有界无锁多生产者单消费者环形队列，保存已格式化好的日志记录
+* 每个槽带一个序号（Vyukov）：生产者用 CAS 领取槽位，直接在槽内格式化后提交；
+* 唯一的消费者按顺序取出连续已提交的槽，用 writev 一次写入文件后再归还
+**************************************************************/
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+using namespace std;
+
+class LogRing {
+private:
+    struct Slot {
+        atomic<size_t> seq;                 // == pos 可写, == pos + 1 已提交可读
+        size_t len;
+    };
+
+    Slot *m_slots;
+    char *m_data;                           // 所有槽的记录内容，每槽 m_record_size 字节
+    size_t m_mask;
+    size_t m_record_size;
+    alignas(64) atomic<size_t> m_enqueue_pos;
+    alignas(64) atomic<size_t> m_dequeue_pos; // 只由消费者修改
+
+public:
+    // capacity 向上取 2 的幂
+    LogRing(size_t capacity, size_t record_size) : m_record_size(record_size), m_enqueue_pos(0), m_dequeue_pos(0) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        m_mask = cap - 1;
+        m_slots = new Slot[cap];
+        m_data = new char[cap * record_size];
+        for (size_t i = 0; i < cap; i++) {
+            m_slots[i].seq.store(i, memory_order_relaxed);
+            m_slots[i].len = 0;
+        }
+    }
+
+    ~LogRing() {
+        delete [] m_slots;
+        delete [] m_data;
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+    size_t record_size() const { return m_record_size; }
+
+    // 近似长度（含已领取未提交的槽）
+    size_t size() const {
+        size_t back = m_enqueue_pos.load(memory_order_relaxed);
+        size_t front = m_dequeue_pos.load(memory_order_relaxed);
+        return back > front ? back - front : 0;
+    }
+
+    // 生产者领取一个槽，返回槽内可写的缓冲区；队列满时返回 NULL
+    char *claim(size_t &pos) {
+        pos = m_enqueue_pos.load(memory_order_relaxed);
+        while (true) {
+            Slot &slot = m_slots[pos & m_mask];
+            intptr_t diff = (intptr_t)slot.seq.load(memory_order_acquire) - (intptr_t)pos;
+            if (diff == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    return m_data + (pos & m_mask) * m_record_size;
+            }
+            else if (diff < 0) {
+                return NULL;
+            }
+            else {
+                pos = m_enqueue_pos.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // 生产者写完后提交，len 为记录的实际长度
+    void commit(size_t pos, size_t len) {
+        Slot &slot = m_slots[pos & m_mask];
+        slot.len = len;
+        slot.seq.store(pos + 1, memory_order_release);
+    }
+
+    // 消费者取出从队首开始连续已提交的记录（最多 max 条），不出队
+    int peek(struct iovec *iov, int max) {
+        int n = 0;
+        for (size_t pos = m_dequeue_pos.load(memory_order_relaxed); n < max; pos++, n++) {
+            Slot &slot = m_slots[pos & m_mask];
+            if (slot.seq.load(memory_order_acquire) != pos + 1)
+                break;
+            iov[n].iov_base = m_data + (pos & m_mask) * m_record_size;
+            iov[n].iov_len = slot.len;
+        }
+        return n;
+    }
+
+    // 消费者写完后归还前 n 个槽
+    void release(int n) {
+        size_t pos = m_dequeue_pos.load(memory_order_relaxed);
+        for (int i = 0; i < n; i++, pos++)
+            m_slots[pos & m_mask].seq.store(pos + m_mask + 1, memory_order_release);
+        m_dequeue_pos.store(pos, memory_order_relaxed);
+    }
+};
+
+#endif
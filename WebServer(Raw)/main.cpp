@@ -15,7 +15,7 @@ int main(int argc, char *argv[]) {
     // 服务端初始化
     server.init(config.PORT, user, passwd, db_name, config.LOG_WRITE,
                 config.OPT_LINGER, config.TRIG_MODE,  config.SQL_NUM,  config.THREAD_NUM,
-                config.CLOSE_LOG, config.ACTOR_MODEL);
+                config.CLOSE_LOG, config.ACTOR_MODEL, config.CPU_AFFINITY, config.LOG_BINARY);
 
     server.log_write();                         // 日志
     server.sql_pool();                          // 数据库
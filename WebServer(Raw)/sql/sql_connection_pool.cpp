@@ -13,6 +13,7 @@ using namespace std;
 ConnectionPool::ConnectionPool() {
 	m_cur_conn = 0;
 	m_free_conn = 0;
+	m_max_conn = 0;
 }
 
 ConnectionPool *ConnectionPool::get_instance() {
@@ -39,6 +40,10 @@ void ConnectionPool::init(string url, string user, string passwd, string db_name
 			exit(1);
 		}
 
+		// 连接断开时由 mysql_ping 自动重连，语句缓存检测到后重新准备
+		bool reconnect = true;
+		mysql_options(conn, MYSQL_OPT_RECONNECT, &reconnect);
+
 		conn = mysql_real_connect(conn, url.c_str(), user.c_str(), passwd.c_str(), db_name.c_str(), port, NULL, 0);
 
 		if (conn == NULL) {
@@ -48,6 +53,7 @@ void ConnectionPool::init(string url, string user, string passwd, string db_name
 
         // 更新连接池和空闲连接数量
         conn_list.push_back(conn);
+		m_stmt_caches[conn] = new StmtCache(conn, close_log);
 		++m_free_conn;
 	}
 
@@ -60,7 +66,7 @@ void ConnectionPool::init(string url, string user, string passwd, string db_name
 MYSQL *ConnectionPool::get_connection() {
 	MYSQL *conn = NULL;
 
-	if (0 == conn_list.size()) return NULL;
+	if (0 == m_max_conn) return NULL;         // 连接池未初始化，连接都被占用时在信号量上等待
 
 	reserve.wait();                         // 取出连接，信号量原子减1，为0则等待
 	lock.lock();
@@ -98,16 +104,23 @@ void ConnectionPool::destroy_pool() {
 		list<MYSQL *>::iterator it;
 		for (it = conn_list.begin(); it != conn_list.end(); ++it) {
 			MYSQL *conn = *it;
+			delete m_stmt_caches[conn];              // 语句要在连接关闭前释放
 			mysql_close(conn);
 		}
 		m_cur_conn = 0;
 		m_free_conn = 0;
 		conn_list.clear();
+		m_stmt_caches.clear();
 	}
 
 	lock.unlock();
 }
 
+StmtCache *ConnectionPool::get_stmts(MYSQL *conn) {
+	map<MYSQL *, StmtCache *>::iterator it = m_stmt_caches.find(conn);
+	return it == m_stmt_caches.end() ? NULL : it->second;
+}
+
 int ConnectionPool::get_free_conn() { return this->m_free_conn; }
 
 ConnectionPool::~ConnectionPool() { destroy_pool(); }
@@ -119,4 +132,19 @@ ConnectionRAII::ConnectionRAII(MYSQL **SQL, ConnectionPool *connPool) {
 	poolRAII = connPool;
 }
 
-ConnectionRAII::~ConnectionRAII(){ poolRAII->release_connection(conRAII); }
\ No newline at end of file
+ConnectionRAII::~ConnectionRAII(){ poolRAII->release_connection(conRAII); }
+LazyConnection::LazyConnection(ConnectionPool *pool) : m_pool(pool), m_conn(NULL) {}
+
+LazyConnection::~LazyConnection() {
+	if (m_conn != NULL) m_pool->release_connection(m_conn);
+}
+
+MYSQL *LazyConnection::get() {
+	if (m_conn == NULL && m_pool != NULL) m_conn = m_pool->get_connection();
+	return m_conn;
+}
+
+StmtCache *LazyConnection::stmts() {
+	MYSQL *conn = get();
+	return conn == NULL ? NULL : m_pool->get_stmts(conn);
+}
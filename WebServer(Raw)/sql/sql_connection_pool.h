@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <list>
+#include <map>
 #include <mysql/mysql.h>
 #include <error.h>
 #include <string.h>
@@ -10,6 +11,7 @@
 #include <string>
 #include "../lock/locker.h"
 #include "../log/log.h"
+#include "sql_stmt_cache.h"
 
 using namespace std;
 
@@ -21,6 +23,7 @@ private:
 	Locker lock;
 	list<MYSQL *> conn_list;                            // 连接池
 	Sem reserve;
+	map<MYSQL *, StmtCache *> m_stmt_caches;          // 每个连接的预处理语句缓存，初始化后只读
 
     ConnectionPool();
     ~ConnectionPool();
@@ -39,6 +42,7 @@ public:
 
     MYSQL *get_connection();				            // 获取一个可用的数据库连接
     bool release_connection(MYSQL *conn);               // 释放当前连接
+    StmtCache *get_stmts(MYSQL *conn);                 // 获取连接对应的语句缓存
     int get_free_conn();					            // 获取可用连接数
     void destroy_pool();	                            // 销毁所有连接
 };
@@ -54,4 +58,19 @@ public:
 	~ConnectionRAII();
 };
 
+// 按需获取数据库连接：第一次调用 get() 时才从连接池取出，析构时若取出过则归还
+// 不访问数据库的请求不会占用连接池的信号量
+class LazyConnection {
+private:
+    ConnectionPool *m_pool;
+    MYSQL *m_conn;
+
+public:
+    explicit LazyConnection(ConnectionPool *pool);
+    ~LazyConnection();
+
+    MYSQL *get();
+    StmtCache *stmts();                                 // 当前连接的语句缓存，会先取出连接
+};
+
 #endif
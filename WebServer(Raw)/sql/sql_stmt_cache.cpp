@@ -0,0 +1,98 @@
+#include <string.h>
+#include <mysql/errmsg.h>
+#include <mysql/mysqld_error.h>
+#include "sql_stmt_cache.h"
+
+static const char *const QUERIES[STMT_NUM] = {
+    "SELECT passwd FROM user WHERE username = ? LIMIT 1",
+    "INSERT INTO user(username, passwd) VALUES(?, ?)",
+};
+
+// 连接断开或服务端丢失语句句柄时的错误码
+static bool is_conn_error(unsigned int err) {
+    return err == CR_SERVER_GONE_ERROR || err == CR_SERVER_LOST ||
+           err == ER_UNKNOWN_STMT_HANDLER || err == ER_NEED_REPREPARE;
+}
+
+StmtCache::StmtCache(MYSQL *conn, int close_log) {
+    m_conn = conn;
+    m_thread_id = 0;
+    m_close_log = close_log;
+    memset(m_stmts, 0, sizeof(m_stmts));
+}
+
+StmtCache::~StmtCache() { reset(); }
+
+void StmtCache::reset() {
+    for (int i = 0; i < STMT_NUM; i++) {
+        if (m_stmts[i] != NULL) {
+            mysql_stmt_close(m_stmts[i]);
+            m_stmts[i] = NULL;
+        }
+    }
+}
+
+// 取已准备的语句，连接重连过时先丢弃旧的句柄
+MYSQL_STMT *StmtCache::prepare(SqlStmtId id) {
+    unsigned long tid = mysql_thread_id(m_conn);
+    if (tid != m_thread_id) {
+        reset();
+        m_thread_id = tid;
+    }
+    if (m_stmts[id] != NULL)
+        return m_stmts[id];
+
+    MYSQL_STMT *stmt = mysql_stmt_init(m_conn);
+    if (stmt == NULL) {
+        LOG_ERROR("MySQL stmt init error");
+        return NULL;
+    }
+    if (mysql_stmt_prepare(stmt, QUERIES[id], strlen(QUERIES[id]))) {
+        LOG_ERROR("MySQL prepare error:%s", mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return NULL;
+    }
+    m_stmts[id] = stmt;
+    return stmt;
+}
+
+// mysql_ping 按 MYSQL_OPT_RECONNECT 重连，之后所有语句重新准备
+bool StmtCache::reconnect() {
+    reset();
+    m_thread_id = 0;
+    return mysql_ping(m_conn) == 0;
+}
+
+int StmtCache::execute(SqlStmtId id, MYSQL_BIND *params, MYSQL_BIND *results) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        MYSQL_STMT *stmt = prepare(id);
+        if (stmt == NULL) {
+            if (attempt == 0 && is_conn_error(mysql_errno(m_conn)) && reconnect())
+                continue;
+            return -1;
+        }
+        if (mysql_stmt_bind_param(stmt, params) || mysql_stmt_execute(stmt)) {
+            if (attempt == 0 && is_conn_error(mysql_stmt_errno(stmt)) && reconnect())
+                continue;
+            LOG_ERROR("MySQL execute error:%s", mysql_stmt_error(stmt));
+            return -1;
+        }
+        if (results == NULL)
+            return (int)mysql_stmt_affected_rows(stmt);
+
+        if (mysql_stmt_bind_result(stmt, results) || mysql_stmt_store_result(stmt)) {
+            LOG_ERROR("MySQL store result error:%s", mysql_stmt_error(stmt));
+            mysql_stmt_free_result(stmt);
+            return -1;
+        }
+        // 取结果出错不能当作没有这一行，否则调用方会认为用户不存在
+        int ret = mysql_stmt_fetch(stmt);
+        if (ret != 0 && ret != MYSQL_DATA_TRUNCATED && ret != MYSQL_NO_DATA)
+            LOG_ERROR("MySQL fetch error:%s", mysql_stmt_error(stmt));
+        mysql_stmt_free_result(stmt);
+        if (ret == 0 || ret == MYSQL_DATA_TRUNCATED)
+            return 1;
+        return ret == MYSQL_NO_DATA ? 0 : -1;
+    }
+    return -1;
+}
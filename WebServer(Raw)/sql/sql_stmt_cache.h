@@ -0,0 +1,38 @@
+#ifndef SQL_STMT_CACHE_H
+#define SQL_STMT_CACHE_H
+
+#include <mysql/mysql.h>
+#include "../log/log.h"
+
+// 服务器使用的固定语句
+enum SqlStmtId {
+    STMT_SELECT_USER = 0,                               // 按用户名查询密码
+    STMT_INSERT_USER,                                   // 注册新用户
+    STMT_NUM
+};
+
+// 连接池中每个连接的预处理语句缓存：第一次使用时准备，之后只以二进制协议发送参数
+// 连接重连后（线程号变化或连接错误）丢弃所有语句并重新准备；只由持有该连接的线程使用
+class StmtCache {
+private:
+    MYSQL *m_conn;
+    unsigned long m_thread_id;                          // 准备语句时的连接线程号
+    MYSQL_STMT *m_stmts[STMT_NUM];
+    int m_close_log;                                    // 日志开关
+
+    MYSQL_STMT *prepare(SqlStmtId id);
+    bool reconnect();
+
+public:
+    StmtCache(MYSQL *conn, int close_log);
+    ~StmtCache();
+
+    // results 非空时取第一行：返回 1 有结果，0 无结果；results 为空时返回影响的行数；出错返回 -1
+    // 连接中断时重连并重试一次
+    int execute(SqlStmtId id, MYSQL_BIND *params, MYSQL_BIND *results = NULL);
+
+    // 关闭所有已准备的语句
+    void reset();
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <pthread.h>
+#include <mysql/mysql.h>
+#include "user_table.h"
+
+UserTable::UserTable() { m_close_log = 1; }
+
+bool UserTable::verify(const char *name, const char *passwd) {
+    string key(name);
+    Shard &shard = shard_of(key);
+
+    shard.lock.rdlock();
+    unordered_map<string, string>::iterator it = shard.users.find(key);
+    bool pass = it != shard.users.end() && it->second == passwd;
+    shard.lock.unlock();
+    return pass;
+}
+
+bool UserTable::contains(const char *name) {
+    string key(name);
+    Shard &shard = shard_of(key);
+
+    shard.lock.rdlock();
+    bool found = shard.users.count(key) != 0;
+    shard.lock.unlock();
+    return found;
+}
+
+bool UserTable::insert(const char *name, const char *passwd) {
+    string key(name);
+    Shard &shard = shard_of(key);
+
+    shard.lock.wrlock();
+    bool inserted = shard.users.insert(make_pair(key, string(passwd))).second;
+    shard.lock.unlock();
+    return inserted;
+}
+
+void UserTable::erase(const char *name) {
+    string key(name);
+    Shard &shard = shard_of(key);
+
+    shard.lock.wrlock();
+    shard.users.erase(key);
+    shard.lock.unlock();
+}
+
+void UserTable::insert_batch(const vector<pair<string, string> > &rows) {
+    // 先按分片分组，再逐个分片加锁写入
+    vector<int> groups[SHARD_NUM];
+    for (size_t i = 0; i < rows.size(); i++)
+        groups[hash<string>()(rows[i].first) & (SHARD_NUM - 1)].push_back(i);
+
+    for (int s = 0; s < SHARD_NUM; s++) {
+        if (groups[s].empty()) continue;
+        Shard &shard = m_shards[s];
+        shard.lock.wrlock();
+        for (size_t k = 0; k < groups[s].size(); k++) {
+            const pair<string, string> &row = rows[groups[s][k]];
+            shard.users[row.first] = row.second;
+        }
+        shard.lock.unlock();
+    }
+}
+
+size_t UserTable::size() {
+    size_t n = 0;
+    for (int s = 0; s < SHARD_NUM; s++) {
+        m_shards[s].lock.rdlock();
+        n += m_shards[s].users.size();
+        m_shards[s].lock.unlock();
+    }
+    return n;
+}
+
+void *UserTable::load_worker(void *arg) {
+    LoadArg *load = (LoadArg *) arg;
+    int m_close_log = load->table->m_close_log;
+
+    MYSQL *mysql = NULL;
+    ConnectionRAII mysql_conn(&mysql, load->connPool);
+    if (mysql == NULL) {
+        load->rows = -1;
+        return NULL;
+    }
+
+    // 多个线程时按 CRC32(username) 取模划分，各线程读取互不重叠的部分
+    char sql[128];
+    if (load->total > 1)
+        snprintf(sql, sizeof(sql), "SELECT username,passwd FROM user WHERE MOD(CRC32(username), %d) = %d",
+                 load->total, load->index);
+    else
+        snprintf(sql, sizeof(sql), "SELECT username,passwd FROM user");
+
+    if (mysql_query(mysql, sql)) {
+        LOG_ERROR("SELECT error:%s\n", mysql_error(mysql));
+        load->rows = -1;
+        return NULL;
+    }
+
+    MYSQL_RES *result = mysql_use_result(mysql);
+    if (result == NULL) {
+        LOG_ERROR("SELECT error:%s\n", mysql_error(mysql));
+        load->rows = -1;
+        return NULL;
+    }
+
+    vector<pair<string, string> > rows;
+    rows.reserve(LOAD_BATCH);
+    load->rows = 0;
+    while (MYSQL_ROW row = mysql_fetch_row(result)) {
+        if (row[0] == NULL || row[1] == NULL) continue;
+        rows.push_back(make_pair(string(row[0]), string(row[1])));
+        if (rows.size() >= LOAD_BATCH) {
+            load->table->insert_batch(rows);
+            load->rows += rows.size();
+            rows.clear();
+        }
+    }
+    if (mysql_errno(mysql)) {
+        LOG_ERROR("fetch error:%s\n", mysql_error(mysql));
+        load->rows = -1;
+    }
+    mysql_free_result(result);
+
+    load->table->insert_batch(rows);
+    if (load->rows >= 0) load->rows += rows.size();
+    return NULL;
+}
+
+long UserTable::load(ConnectionPool *connPool, int thread_num, int close_log) {
+    m_close_log = close_log;
+    if (thread_num < 1) thread_num = 1;
+
+    vector<LoadArg> args(thread_num);
+    vector<pthread_t> threads(thread_num);
+    for (int i = 0; i < thread_num; i++) {
+        args[i].table = this;
+        args[i].connPool = connPool;
+        args[i].index = i;
+        args[i].total = thread_num;
+        args[i].rows = 0;
+    }
+
+    // 第 0 部分由当前线程读取，线程创建失败时也在当前线程读取
+    for (int i = 1; i < thread_num; i++) {
+        if (pthread_create(&threads[i], NULL, load_worker, &args[i])) {
+            threads[i] = 0;
+            load_worker(&args[i]);
+        }
+    }
+    load_worker(&args[0]);
+
+    long total = 0;
+    for (int i = 0; i < thread_num; i++) {
+        if (i > 0 && threads[i] != 0) pthread_join(threads[i], NULL);
+        if (args[i].rows < 0) total = -1;
+        else if (total >= 0) total += args[i].rows;
+    }
+
+    if (total < 0) {
+        LOG_ERROR("load user table failed");
+    }
+    else {
+        LOG_INFO("load %ld users with %d threads", total, thread_num);
+    }
+    return total;
+}
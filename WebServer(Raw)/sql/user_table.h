@@ -0,0 +1,59 @@
+#ifndef USER_TABLE_H
+#define USER_TABLE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "../lock/locker.h"
+#include "sql_connection_pool.h"
+
+using namespace std;
+
+// 内存中的用户表：按用户名哈希分成 SHARD_NUM 个分片，每个分片一把读写锁
+// 登录只对一个分片加读锁，注册只对一个分片加写锁，不同用户之间基本不会互相等待
+class UserTable {
+public:
+    static const int SHARD_NUM = 64;                    // 2 的幂
+    static const int LOAD_BATCH = 4096;                 // 启动加载时每批写入的行数
+
+    UserTable();
+
+    // 用户存在且密码一致
+    bool verify(const char *name, const char *passwd);
+    bool contains(const char *name);
+
+    // 用户名不存在时插入并返回 true，已存在时返回 false
+    bool insert(const char *name, const char *passwd);
+    void erase(const char *name);
+
+    // 批量插入，每个分片只加一次锁，已存在的用户被覆盖
+    void insert_batch(const vector<pair<string, string> > &rows);
+
+    size_t size();
+
+    // 用连接池中的 thread_num 个连接并行读取 user 表，每个线程读取按用户名 CRC32 划分的一部分
+    // 结果逐行流式读取，不在客户端缓存整个结果集；返回读取的行数，出错返回 -1
+    long load(ConnectionPool *connPool, int thread_num, int close_log);
+
+private:
+    struct Shard {
+        RwLocker lock;
+        unordered_map<string, string> users;
+    };
+
+    struct LoadArg {
+        UserTable *table;
+        ConnectionPool *connPool;
+        int index;
+        int total;
+        long rows;                                      // 读取的行数，出错为 -1
+    };
+
+    Shard &shard_of(const string &name) { return m_shards[hash<string>()(name) & (SHARD_NUM - 1)]; }
+    static void *load_worker(void *arg);
+
+    Shard m_shards[SHARD_NUM];
+    int m_close_log;                                    // 日志开关
+};
+
+#endif
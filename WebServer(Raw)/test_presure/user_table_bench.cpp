@@ -0,0 +1,113 @@
+//
+// 用户表查找性能测试：插入 N 个用户后，多个线程随机查找，对比分片用户表与全局锁保护的 map
+// 用法：./user_bench [用户数，默认 1000000] [线程数，默认 4] [每线程查找次数，默认 1000000]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "../sql/user_table.h"
+
+using namespace std;
+
+static int g_users = 1000000;
+static int g_threads = 4;
+static int g_lookups = 1000000;
+
+static UserTable table;
+static map<string, string> tree;
+static Locker tree_lock;
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void make_user(int i, char *name, char *passwd) {
+    sprintf(name, "user%d", i);
+    sprintf(passwd, "pw%d", i);
+}
+
+// 随机查找，一半为存在的用户，一半为不存在的用户
+static void *lookup_table(void *arg) {
+    unsigned int seed = (unsigned int)(long) arg;
+    char name[32], passwd[32];
+    long hit = 0;
+    for (int i = 0; i < g_lookups; i++) {
+        make_user(rand_r(&seed) % (g_users * 2), name, passwd);
+        hit += table.verify(name, passwd);
+    }
+    return (void *) hit;
+}
+
+static void *lookup_tree(void *arg) {
+    unsigned int seed = (unsigned int)(long) arg;
+    char name[32], passwd[32];
+    long hit = 0;
+    for (int i = 0; i < g_lookups; i++) {
+        make_user(rand_r(&seed) % (g_users * 2), name, passwd);
+        tree_lock.lock();
+        map<string, string>::iterator it = tree.find(name);
+        hit += it != tree.end() && it->second == passwd;
+        tree_lock.unlock();
+    }
+    return (void *) hit;
+}
+
+static void run(const char *title, void *(*func)(void *)) {
+    vector<pthread_t> threads(g_threads);
+    double start = now();
+    for (int i = 0; i < g_threads; i++)
+        pthread_create(&threads[i], NULL, func, (void *)(long)(i + 1));
+
+    long hit = 0;
+    for (int i = 0; i < g_threads; i++) {
+        void *ret;
+        pthread_join(threads[i], &ret);
+        hit += (long) ret;
+    }
+    double cost = now() - start;
+    long total = (long) g_threads * g_lookups;
+    printf("%-24s %ld lookups (%ld hits) in %.3fs, %.2f M lookups/s\n", title, total, hit, cost, total / cost / 1e6);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) g_users = atoi(argv[1]);
+    if (argc > 2) g_threads = atoi(argv[2]);
+    if (argc > 3) g_lookups = atoi(argv[3]);
+    if (g_users <= 0 || g_threads <= 0 || g_lookups <= 0) {
+        printf("usage: %s [users] [threads] [lookups per thread]\n", argv[0]);
+        return 1;
+    }
+
+    char name[32], passwd[32];
+    vector<pair<string, string> > rows;
+    rows.reserve(UserTable::LOAD_BATCH);
+
+    double start = now();
+    for (int i = 0; i < g_users; i++) {
+        make_user(i, name, passwd);
+        rows.push_back(make_pair(string(name), string(passwd)));
+        if (rows.size() >= UserTable::LOAD_BATCH || i == g_users - 1) {
+            table.insert_batch(rows);
+            rows.clear();
+        }
+    }
+    printf("UserTable load %zu users in %.3fs\n", table.size(), now() - start);
+
+    start = now();
+    for (int i = 0; i < g_users; i++) {
+        make_user(i, name, passwd);
+        tree[name] = passwd;
+    }
+    printf("std::map  load %zu users in %.3fs\n", tree.size(), now() - start);
+
+    run("UserTable (64 shards)", lookup_table);
+    run("std::map + Locker", lookup_tree);
+    return 0;
+}
@@ -6,8 +6,11 @@
 #define THREADPOOL_H
 
 #include <list>
+#include <vector>
 #include <cstdio>
 #include <exception>
+#include <sched.h>
+#include <unistd.h>
 #include "../lock/locker.h"
 #include "../sql/sql_connection_pool.h"
 
@@ -22,22 +25,32 @@ private:
     Locker m_queue_locker;                              // 请求队列的互斥锁
     Sem m_queue_stat;                                   // 请求队列状态，是否有任务需要处理
     ConnectionPool *m_connPool;                         // 数据库连接池
+    int m_first_cpu;                                    // 第一个工作线程绑定的 CPU，-1 表示不绑定
+    int m_started;                                      // 已启动的工作线程数，用于给线程编号
+    int m_close_log;
 
     // 工作线程的运行函数，它不断从工作队列中取出任务并执行
     static void *worker(void *arg);
     void run();
 
 public:
-    ThreadPool(int actor_model, ConnectionPool *connPool, int thread_number = 8, int max_request = 10000);
+    ThreadPool(int actor_model, ConnectionPool *connPool, int thread_number = 8, int max_request = 10000, int first_cpu = -1, int close_log = 1);
     ~ThreadPool();
 
+    // 进程允许使用的 CPU 列表（sched_getaffinity），taskset/cgroup 限制后的 CPU 编号不一定从 0 开始连续
+    static const std::vector<int> &allowed_cpus();
+    // 第 index 个分配位置对应的 CPU，超出 CPU 数时循环使用
+    static int cpu_of(int index);
+    // 将当前线程绑定到第 index 个分配位置对应的 CPU
+    static bool bind_cpu(int index);
+
     // 向请求队列中插入任务请求
     bool append(T *request, int state);
     bool append(T *request);
 };
 
 template <typename T>
-ThreadPool<T>::ThreadPool(int actor_model, ConnectionPool *connPool, int thread_number, int max_request) : m_actor_model(actor_model), m_connPool(connPool), m_thread_number(thread_number), m_max_requests(max_request), m_threads(NULL) {
+ThreadPool<T>::ThreadPool(int actor_model, ConnectionPool *connPool, int thread_number, int max_request, int first_cpu, int close_log) : m_actor_model(actor_model), m_connPool(connPool), m_thread_number(thread_number), m_max_requests(max_request), m_threads(NULL), m_first_cpu(first_cpu), m_started(0), m_close_log(close_log) {
     if(thread_number <= 0 || max_request <= 0) throw std::exception();
 
     m_threads = new pthread_t[m_thread_number];
@@ -96,6 +109,36 @@ bool ThreadPool<T>::append(T *request) {
     return true;
 }
 
+template <typename T>
+const std::vector<int> &ThreadPool<T>::allowed_cpus() {
+    static std::vector<int> cpus = [] {
+        std::vector<int> list;
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+            for (int i = 0; i < CPU_SETSIZE; i++)
+                if (CPU_ISSET(i, &mask)) list.push_back(i);
+        }
+        if (list.empty()) list.push_back(0);
+        return list;
+    }();
+    return cpus;
+}
+
+template <typename T>
+int ThreadPool<T>::cpu_of(int index) {
+    const std::vector<int> &cpus = allowed_cpus();
+    return cpus[index % cpus.size()];
+}
+
+template <typename T>
+bool ThreadPool<T>::bind_cpu(int index) {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu_of(index), &mask);
+    return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+}
+
 template<typename T>
 void *ThreadPool<T>::worker(void *arg) {
     // 将参数强转为线程池类，调用成员方法
@@ -107,6 +150,13 @@ void *ThreadPool<T>::worker(void *arg) {
 
 template <typename T>
 void ThreadPool<T>::run() {
+    // 依次绑定到 m_first_cpu 之后的 CPU，请求对象在绑定后的线程中处理
+    if (m_first_cpu >= 0) {
+        int index = m_first_cpu + __sync_fetch_and_add(&m_started, 1);
+        if (!bind_cpu(index)) {
+            LOG_WARN("bind worker to cpu %d failed", cpu_of(index));
+        }
+    }
     while(true) {
         m_queue_stat.wait();            // 等待请求队列中插入新的任务
         m_queue_locker.lock();          // 加锁
@@ -128,7 +178,7 @@ void ThreadPool<T>::run() {
             if(0 == request->m_state) {
                 if(request->read_once()) {
                     request->improv = 1;
-                    ConnectionRAII mysql_conn(&request->mysql, m_connPool);
+                    request->conn_pool = m_connPool;
                     request->process();
                 }
                 else {
@@ -146,7 +196,8 @@ void ThreadPool<T>::run() {
             }
         }
         else {
-            ConnectionRAII mysql_conn(&request->mysql, m_connPool);
+            // 数据库连接在请求真正需要时才获取，静态文件请求不占用连接池
+            request->conn_pool = m_connPool;
             request->process();
         }
     }
@@ -0,0 +1,200 @@
+//
+// Created by Derrors on 2021/5/9.
+//
+
+#include "heap_timer.h"
+#include "../http/http_conn.h"
+
+TimerHeap::TimerHeap() {
+    m_timerfd = -1;
+    m_armed = 0;
+}
+
+TimerHeap::~TimerHeap() {
+    for (size_t i = 0; i < m_heap.size(); ++i)
+        delete m_heap[i];
+    if (m_timerfd >= 0)
+        close(m_timerfd);
+}
+
+int TimerHeap::init() {
+    m_timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    assert(m_timerfd >= 0);
+    m_heap.reserve(1024);
+    return m_timerfd;
+}
+
+uint64_t TimerHeap::now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 交换两个定时器，同时更新它们记录的下标
+void TimerHeap::swap_timer(size_t i, size_t j) {
+    UtilTimer *tmp = m_heap[i];
+    m_heap[i] = m_heap[j];
+    m_heap[j] = tmp;
+    m_heap[i]->heap_index = i;
+    m_heap[j]->heap_index = j;
+}
+
+// 从第 i 个结点开始向上调整
+void TimerHeap::sift_up(size_t i) {
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (m_heap[parent]->expire <= m_heap[i]->expire) break;
+        swap_timer(i, parent);
+        i = parent;
+    }
+}
+
+// 从第 i 个结点开始向下调整，返回结点是否移动过
+bool TimerHeap::sift_down(size_t i) {
+    size_t index = i;
+    size_t n = m_heap.size();
+    size_t child = i * 2 + 1;
+    while (child < n) {
+        // 取左右孩子中超时时间较小的一个
+        if (child + 1 < n && m_heap[child + 1]->expire < m_heap[child]->expire) child++;
+        if (m_heap[i]->expire <= m_heap[child]->expire) break;
+        swap_timer(i, child);
+        i = child;
+        child = i * 2 + 1;
+    }
+    return i > index;
+}
+
+// 添加定时器，插入堆尾后向上调整
+void TimerHeap::add_timer(UtilTimer *timer) {
+    if (!timer) return;
+
+    timer->heap_index = m_heap.size();
+    m_heap.push_back(timer);
+    sift_up(timer->heap_index);
+}
+
+// 调整定时器，超时时间变化后调整它在堆中的位置
+void TimerHeap::adjust_timer(UtilTimer *timer) {
+    if (!timer || timer->heap_index < 0) return;
+
+    if (!sift_down(timer->heap_index))
+        sift_up(timer->heap_index);
+}
+
+// 将定时器移出堆：与堆尾交换后删除堆尾，再调整换过来的结点
+void TimerHeap::remove(UtilTimer *timer) {
+    size_t i = timer->heap_index;
+    size_t last = m_heap.size() - 1;
+    if (i != last) {
+        swap_timer(i, last);
+    }
+    m_heap.pop_back();
+    timer->heap_index = -1;
+    if (i < m_heap.size() && !sift_down(i))
+        sift_up(i);
+}
+
+// 删除定时器
+void TimerHeap::del_timer(UtilTimer *timer) {
+    if (!timer) return;
+
+    if (timer->heap_index >= 0)
+        remove(timer);
+    delete timer;
+}
+
+// 定时任务处理函数
+void TimerHeap::tick() {
+    // 读出 timerfd 的到期次数，清除可读状态
+    uint64_t expirations;
+    while (read(m_timerfd, &expirations, sizeof(expirations)) > 0) {}
+    m_armed = 0;
+
+    uint64_t cur = now_ms();
+    while (!m_heap.empty()) {
+        UtilTimer *tmp = m_heap[0];
+        if (cur < tmp->expire) break;                   // 堆顶未超时，其余定时器也未超时
+
+        // 先移出堆再回调，回调中连接资源不再指向该定时器
+        remove(tmp);
+        tmp->user_data->timer = NULL;
+        tmp->cb_func(tmp->user_data);
+        delete tmp;
+    }
+}
+
+// 按堆顶的超时时间设置 timerfd（绝对时间），堆顶未变时不做系统调用
+void TimerHeap::rearm() {
+    uint64_t expire = m_heap.empty() ? 0 : m_heap[0]->expire;
+    if (expire == m_armed) return;
+
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (expire) {
+        its.it_value.tv_sec = expire / 1000;
+        its.it_value.tv_nsec = (expire % 1000) * 1000000;
+    }
+    timerfd_settime(m_timerfd, TFD_TIMER_ABSTIME, &its, NULL);
+    m_armed = expire;
+}
+
+// 对文件描述符设置非阻塞
+int Utils::set_nonblocking(int fd) {
+    int old_option = fcntl(fd, F_GETFL);
+    int new_option = old_option | O_NONBLOCK;
+    fcntl(fd, F_SETFL, new_option);
+    return old_option;
+}
+
+// 向内核事件表注册读事件，ET 模式，选择开启 EPOLLONESHOT
+void Utils::add_fd(int epollfd, int fd, bool one_shot, int trig_mode) {
+    epoll_event event;
+    event.data.fd = fd;
+
+    if (1 == trig_mode)
+        event.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
+    else
+        event.events = EPOLLIN | EPOLLRDHUP;
+
+    if (one_shot)
+        event.events |= EPOLLONESHOT;
+    epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &event);
+    set_nonblocking(fd);
+}
+
+// 设置信号函数
+void Utils::add_sig(int sig, void(handler)(int), bool restart) {
+    struct sigaction sa;
+    memset(&sa, '\0', sizeof(sa));
+    sa.sa_handler = handler;
+    if (restart)
+        sa.sa_flags |= SA_RESTART;
+    sigfillset(&sa.sa_mask);
+    assert(sigaction(sig, &sa, NULL) != -1);
+}
+
+// 定时处理任务，在 timerfd 可读时调用
+void Utils::timer_handler() {
+    m_timer_heap.tick();
+}
+
+void Utils::show_error(int connfd, const char *info) {
+    send(connfd, info, strlen(info), 0);
+    close(connfd);
+}
+
+int Utils::u_epollfd = 0;
+
+// 定时器回调函数: 从内核事件表删除事件，关闭文件描述符，释放连接资源
+void cb_func(ClientData *user_data) {
+    // 删除非活动连接在 socket 上的注册事件
+    epoll_ctl(Utils::u_epollfd, EPOLL_CTL_DEL, user_data->sockfd, 0);
+
+    assert(user_data);
+
+    // 关闭文件描述符
+    close(user_data->sockfd);
+    // 减少连接数
+    HttpConn::m_user_count--;
+}
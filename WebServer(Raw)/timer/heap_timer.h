@@ -1,5 +1,5 @@
-#ifndef LST_TIMER
-#define LST_TIMER
+#ifndef HEAP_TIMER
+#define HEAP_TIMER
 
 #include <unistd.h>
 #include <signal.h>
@@ -20,6 +20,10 @@
 #include <errno.h>
 #include <sys/wait.h>
 #include <sys/uio.h>
+#include <sys/timerfd.h>
+#include <stdint.h>
+
+#include <vector>
 
 #include <time.h>
 #include "../log/log.h"
@@ -36,60 +40,66 @@ struct ClientData {
 // 定时器类
 class UtilTimer {
 public:
-    time_t expire;                                  // 超时时间
+    uint64_t expire;                                // 超时时间（CLOCK_MONOTONIC，毫秒）
     void (* cb_func) (ClientData *);                // 回调函数
 
     ClientData *user_data;                          // 连接资源
-    UtilTimer *prev;                                // 前向定时器
-    UtilTimer *next;                                // 后继定时器
+    int heap_index;                                 // 在堆中的下标，-1 表示不在堆中
 
-    UtilTimer() : prev(NULL), next(NULL) {}
+    UtilTimer() : expire(0), cb_func(NULL), user_data(NULL), heap_index(-1) {}
 };
 
-// 定时器容器类
-class SortTimerLst {
+// 定时器容器类：按超时时间组织的最小堆，添加、调整、删除均为 O(log n)
+// 堆顶的超时时间写入 timerfd，由 epoll 通知到期，不再依赖 SIGALRM
+class TimerHeap {
 private:
-    UtilTimer *head;
-    UtilTimer *tail;
+    std::vector<UtilTimer *> m_heap;
+    int m_timerfd;
+    uint64_t m_armed;                               // timerfd 当前设置的超时时间，0 表示未设置
 
-    // 私有成员，被公有成员 add_timer 和 adjust_time 调用, 主要用于调整链表内部结点
-    void add_timer(UtilTimer *timer, UtilTimer *lst_head);
+    void sift_up(size_t i);
+    bool sift_down(size_t i);
+    void swap_timer(size_t i, size_t j);
+    void remove(UtilTimer *timer);
 
 public:
-    SortTimerLst();
-    ~SortTimerLst();
+    TimerHeap();
+    ~TimerHeap();
+
+    // 创建 timerfd，返回其文件描述符，由调用方注册到 epoll
+    int init();
 
     void add_timer(UtilTimer *timer);
     void adjust_timer(UtilTimer *timer);
     void del_timer(UtilTimer *timer);
+
+    // 处理所有到期的定时器
     void tick();
+
+    // 堆顶变化后重新设置 timerfd，每轮事件循环结束时调用一次
+    void rearm();
+
+    static uint64_t now_ms();
 };
 
 class Utils {
 public:
-    static int *u_pipefd;
     static int u_epollfd;
-    SortTimerLst m_timer_lst;
-    int m_time_slot;
+    TimerHeap m_timer_heap;
 
     Utils() {}
     ~Utils() {}
 
-    void init(int time_slot);
-
     // 对文件描述符设置非阻塞
     int set_nonblocking(int fd);
 
     // 向内核事件表注册读事件，ET 模式，选择开启 EPOLLONESHOT
     void add_fd(int epollfd, int fd, bool one_shot, int trig_mode);
 
-    // 信号处理函数
-    static void sig_handler(int sig);
-
     // 设置信号函数
     void add_sig(int sig, void (handler) (int), bool restart = true);
 
-    // 定时处理任务，重新定时以不断触发 SIGALRM 信号
+    // 定时处理任务，在 timerfd 可读时调用
     void timer_handler();
 
     void show_error(int connfd, const char *info);
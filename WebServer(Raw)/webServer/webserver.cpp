@@ -1,7 +1,7 @@
 #include "webserver.h"
 
 WebServer::WebServer() {
-    users = new HttpConn[MAX_FD];                           // HttpConn 类对象
+    users = NULL;                                           // HttpConn 类对象，在 init 中分配
     char server_path[200];                                  // root 文件夹路径
     getcwd(server_path, 200);
 
@@ -10,21 +10,28 @@ WebServer::WebServer() {
     strcpy(m_root, server_path);
     strcat(m_root, root);
 
-    users_timer = new ClientData[MAX_FD];                  // 定时器
+    users_timer = NULL;                                     // 定时器，在 init 中分配
+
+    // 在创建任何线程之前屏蔽 SIGTERM，之后创建的线程都继承该屏蔽字，信号统一由主线程通过 signalfd 读取
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+    m_signalfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    assert(m_signalfd != -1);
 }
 
 WebServer::~WebServer() {
     close(m_epollfd);
     close(m_listenfd);
-    close(m_pipefd[1]);
-    close(m_pipefd[0]);
+    close(m_signalfd);
 
     delete[] users;
     delete[] users_timer;
     delete m_pool;
 }
 
-void WebServer::init(int port, string user, string passwd, string db_name, int log_write, int opt_linger, int trig_mode, int sql_num, int thread_num, int close_log, int actor_model) {
+void WebServer::init(int port, string user, string passwd, string db_name, int log_write, int opt_linger, int trig_mode, int sql_num, int thread_num, int close_log, int actor_model, int cpu_affinity, int log_binary) {
     m_port = port;
     m_user = user;
     m_passwd = passwd;
@@ -36,6 +43,14 @@ void WebServer::init(int port, string user, string passwd, string db_name, int l
     m_trig_mode = trig_mode;
     m_close_log = close_log;
     m_actor_model = actor_model;
+    m_cpu_affinity = cpu_affinity;
+    m_log_binary = log_binary;
+
+    // 主线程先绑定 CPU 再分配连接资源，按首次访问策略，内存分配在主线程所在的 NUMA 结点；
+    // 此时日志尚未初始化，绑定失败在 thread_pool 中记录
+    m_main_bound = m_cpu_affinity && ThreadPool<HttpConn>::bind_cpu(0);
+    users = new HttpConn[MAX_FD];
+    users_timer = new ClientData[MAX_FD];
 }
 
 void WebServer::trig_mode() {
@@ -61,10 +76,14 @@ void WebServer::trig_mode() {
 // 初始化日志
 void WebServer::log_write() {
     if (0 == m_close_log) {
+        // 二进制日志用 WebServer(C++11) 的 log_decoder 解码（make decoder）
+        const char *file_name = m_log_binary ? "./ServerLog.blog" : "./ServerLog";
         if (1 == m_log_write)
-            Log::get_instance()->init("./ServerLog", m_close_log, 2000, 800000, 800);
+            Log::get_instance()->init(file_name, m_close_log, 2000, 800000, 800, false, m_log_binary);
+        else if (2 == m_log_write)
+            Log::get_instance()->init(file_name, m_close_log, 2000, 800000, 800, true, m_log_binary);
         else
-            Log::get_instance()->init("./ServerLog", m_close_log, 2000, 800000, 0);
+            Log::get_instance()->init(file_name, m_close_log, 2000, 800000, 0, false, m_log_binary);
     }
 }
 
@@ -79,7 +98,10 @@ void WebServer::sql_pool() {
 
 // 线程池
 void WebServer::thread_pool() {
-    m_pool = new ThreadPool<HttpConn>(m_actor_model, m_connPool, m_thread_num);
+    if (m_cpu_affinity && !m_main_bound) {
+        LOG_WARN("bind main thread to cpu %d failed", ThreadPool<HttpConn>::cpu_of(0));
+    }
+    m_pool = new ThreadPool<HttpConn>(m_actor_model, m_connPool, m_thread_num, 10000, m_cpu_affinity ? 1 : -1, m_close_log);
 }
 
 // 网络监听
@@ -110,8 +132,6 @@ void WebServer::event_listen() {
     ret = listen(m_listenfd, 5);
     assert(ret >= 0);
 
-    utils.init(TIMESLOT);
-
     // epoll创建内核事件表
     epoll_event events[MAX_EVENT_NUMBER];
     m_epollfd = epoll_create(5);
@@ -120,19 +140,14 @@ void WebServer::event_listen() {
     utils.add_fd(m_epollfd, m_listenfd, false, m_listen_trig_mode);
     HttpConn::m_epollfd = m_epollfd;
 
-    ret = socketpair(PF_UNIX, SOCK_STREAM, 0, m_pipefd);
-    assert(ret != -1);
-    utils.set_nonblocking(m_pipefd[1]);
-    utils.add_fd(m_epollfd, m_pipefd[0], false, 0);
+    // 定时器和信号都以文件描述符的形式注册到 epoll
+    m_timerfd = utils.m_timer_heap.init();
+    utils.add_fd(m_epollfd, m_timerfd, false, 0);
+    utils.add_fd(m_epollfd, m_signalfd, false, 0);
 
     utils.add_sig(SIGPIPE, SIG_IGN);
-    utils.add_sig(SIGALRM, utils.sig_handler, false);
-    utils.add_sig(SIGTERM, utils.sig_handler, false);
-
-    alarm(TIMESLOT);
 
     // 工具类,信号和描述符基础操作
-    Utils::u_pipefd = m_pipefd;
     Utils::u_epollfd = m_epollfd;
 }
 
@@ -147,26 +162,28 @@ void WebServer::timer(int connfd, struct sockaddr_in client_address) {
     UtilTimer *timer = new UtilTimer;
     timer->user_data = &users_timer[connfd];
     timer->cb_func = cb_func;
-    time_t cur = time(NULL);
-    timer->expire = cur + 3 * TIMESLOT;
+    timer->expire = TimerHeap::now_ms() + TIMEOUT_MS;
     users_timer[connfd].timer = timer;
-    utils.m_timer_lst.add_timer(timer);
+    utils.m_timer_heap.add_timer(timer);
 }
 
-// 若有数据传输，则将定时器往后延迟3个单位并对新的定时器在链表上的位置进行调整
+// 若有数据传输，则将定时器往后延迟 TIMEOUT_MS 并调整它在堆中的位置
 void WebServer::adjust_timer(UtilTimer *timer) {
-    time_t cur = time(NULL);
-    timer->expire = cur + 3 * TIMESLOT;
-    utils.m_timer_lst.adjust_timer(timer);
+    timer->expire = TimerHeap::now_ms() + TIMEOUT_MS;
+    utils.m_timer_heap.adjust_timer(timer);
 
     LOG_INFO("%s", "adjust timer once");
 }
 
 // 处理定时器
 void WebServer::deal_timer(UtilTimer *timer, int sockfd) {
+    // 定时器为空说明连接已超时关闭
+    if (!timer)
+        return;
+
     timer->cb_func(&users_timer[sockfd]);
-    if (timer)
-        utils.m_timer_lst.del_timer(timer);
+    utils.m_timer_heap.del_timer(timer);
+    users_timer[sockfd].timer = NULL;
 
     LOG_INFO("close fd %d", users_timer[sockfd].sockfd);
 }
@@ -212,25 +229,17 @@ bool WebServer::deal_client_data() {
 }
 
 // 处理信号
-bool WebServer::deal_with_signal(bool &timeout, bool &stop_server) {
-    int ret = 0;
-    char signals[1024];
-    ret = recv(m_pipefd[0], signals, sizeof(signals), 0);
-    if (ret == -1)
-        return false;
-    else if (ret == 0) {
+bool WebServer::deal_with_signal(bool &stop_server) {
+    struct signalfd_siginfo info[16];
+    int ret = read(m_signalfd, info, sizeof(info));
+    if (ret <= 0)
         return false;
-    }
-    else {
-        for (int i = 0; i < ret; ++i) {
-            switch (signals[i]) {
-                case SIGALRM:
-                    timeout = true;
-                    break;
-                case SIGTERM:
-                    stop_server = true;
-                    break;
-            }
+
+    for (size_t i = 0; i < ret / sizeof(info[0]); ++i) {
+        switch (info[i].ssi_signo) {
+            case SIGTERM:
+                stop_server = true;
+                break;
         }
     }
     return true;
@@ -338,12 +347,15 @@ void WebServer::event_loop() {
                 UtilTimer *timer = users_timer[sockfd].timer;
                 deal_timer(timer, sockfd);
             }
+            // 定时器到期
+            else if ((sockfd == m_timerfd) && (events[i].events & EPOLLIN)) {
+                timeout = true;
+            }
             // 处理信号
-            else if ((sockfd == m_pipefd[0]) && (events[i].events & EPOLLIN)) {
-                // 接收到 SIGALRM 信号，timeout 设置为 true
-                bool flag = deal_with_signal(timeout, stop_server);
+            else if ((sockfd == m_signalfd) && (events[i].events & EPOLLIN)) {
+                bool flag = deal_with_signal(stop_server);
                 if (false == flag)
-                    LOG_ERROR("%s", "deal client data failure");
+                    LOG_ERROR("%s", "deal signal failure");
             }
             // 处理客户连接上接收到的数据
             else if (events[i].events & EPOLLIN) {
@@ -360,5 +372,7 @@ void WebServer::event_loop() {
             LOG_INFO("%s", "timer tick");
             timeout = false;
         }
+        // 本轮中添加、调整、删除的定时器可能改变了堆顶
+        utils.m_timer_heap.rearm();
     }
 }
\ No newline at end of file
@@ -11,13 +11,14 @@
 #include <stdlib.h>
 #include <cassert>
 #include <sys/epoll.h>
+#include <sys/signalfd.h>
 
 #include "../threadpool/threadpool.h"
 #include "../http/http_conn.h"
 
 const int MAX_FD = 65536;                   // 最大文件描述符
 const int MAX_EVENT_NUMBER = 10000;         // 最大事件数
-const int TIMESLOT = 5;                     // 最小超时单位
+const int TIMEOUT_MS = 15000;               // 非活动连接的超时时间（毫秒）
 
 class WebServer {
 public:
@@ -26,8 +27,12 @@ public:
     int m_log_write;
     int m_close_log;
     int m_actor_model;
+    int m_cpu_affinity;                     // 是否绑定 CPU：主线程第一个允许使用的 CPU，工作线程依次其后
+    bool m_main_bound;                      // 主线程是否绑定成功
+    int m_log_binary;                       // 是否使用二进制日志
 
-    int m_pipefd[2];
+    int m_timerfd;                          // 定时器到期通知
+    int m_signalfd;                         // 信号通知
     int m_epollfd;
     HttpConn *users;
 
@@ -61,7 +66,7 @@ public:
 
     void init(int port , string user, string passwd, string db_name,
               int log_write , int opt_linger, int trig_mode, int sql_num,
-              int thread_num, int close_log, int actor_model);
+              int thread_num, int close_log, int actor_model, int cpu_affinity, int log_binary);
 
     void thread_pool();
     void sql_pool();
@@ -73,7 +78,7 @@ public:
     void adjust_timer(UtilTimer *timer);
     void deal_timer(UtilTimer *timer, int sockfd);
     bool deal_client_data();
-    bool deal_with_signal(bool& timeout, bool& stop_server);
+    bool deal_with_signal(bool& stop_server);
     void deal_with_read(int sockfd);
     void deal_with_write(int sockfd);
 